@@ -22,7 +22,7 @@ libspicec_link_objs 	:= $(CROSS_DIR)/lib/libintl.a \
 
 LOCAL_MODULE    := spicec
 
-LOCAL_SRC_FILES := jpeg_encoder.c spicy.c spice-cmdline.c android-worker.c android-spice.c coroutine_gthread.c spice-util.c spice-session.c spice-channel.c spice-marshal.c spice-glib-enums.c generated_demarshallers.c generated_demarshallers1.c generated_marshallers.c generated_marshallers1.c gio-coroutine.c channel-base.c channel-main.c channel-display.c channel-display-mjpeg.c channel-inputs.c decode-glz.c decode-jpeg.c decode-zlib.c mem.c marshaller.c canvas_utils.c sw_canvas.c pixman_utils.c lines.c rop3.c quic.c lz.c region.c ssl_verify.c
+LOCAL_SRC_FILES := jpeg_encoder.c spicy.c spice-cmdline.c android-worker.c android-codec.c android-spice.c spice-util.c spice-trace.c spice-session.c spice-channel.c spice-marshal.c spice-glib-enums.c generated_demarshallers.c generated_demarshallers1.c generated_marshallers.c generated_marshallers1.c gio-coroutine.c channel-base.c channel-main.c channel-display.c channel-display-mjpeg.c channel-inputs.c decode-glz.c decode-jpeg.c decode-zlib.c mem.c marshaller.c canvas_utils.c sw_canvas.c pixman_utils.c lines.c rop3.c quic.c lz.c region.c ssl_verify.c
 
 LOCAL_LDLIBS 	+= $(libspicec_link_objs) \
 		   -L$(CROSS_DIR)/lib \
@@ -41,8 +41,23 @@ LOCAL_C_INCLUDES += $(CROSS_DIR)/include/spice-1 \
 		    $(CROSS_DIR)/lib/glib-2.0/include \
 		    $(CROSS_DIR)/include/crypto
 
+# coroutine backend: "ucontext" switches stacks in the main loop thread
+# (continuation.c, assembly on arm/x86, ucontext elsewhere), "gthread"
+# runs each coroutine in its own thread and hands a lock over on swaps
+SPICE_COROUTINE ?= ucontext
+ifeq ($(SPICE_COROUTINE),gthread)
+LOCAL_SRC_FILES += coroutine_gthread.c
+else
+LOCAL_SRC_FILES += coroutine_ucontext.c continuation.c
+LOCAL_CPPFLAGS 	+= -DWITH_UCONTEXT=1
+endif
+
 LOCAL_CFLAGS 	:= $(LOCAL_CPPFLAGS) \
     -std=gnu99 -Wall -Wno-sign-compare -Wno-deprecated-declarations -Wl,--no-undefined \
     -fPIC -DPIC 
 
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_NEON 	:= true
+endif
+
 include $(BUILD_SHARED_LIBRARY)
@@ -0,0 +1,182 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see <http://www.gnu.org/licenses/>.
+*/
+#include <zlib.h>
+#include "spice-common.h"
+#include "android-spice.h"
+#include "jpeg_encoder.h"
+
+/*
+ * Picks the cheapest adequate encoding of an update sent to Java, from
+ * a single pass over its pixels:
+ *  - one color: ANDROID_SHOW_FILL, the color alone;
+ *  - few colors (UI, text): ANDROID_SHOW_PALETTE, a palette and runs;
+ *  - many colors but mostly flat (antialiased text, gradients in
+ *    toolbars): ANDROID_SHOW_ZLIB, the raw pixels deflated at speed 1;
+ *  - anything else is considered photographic: ANDROID_SHOW, JPEG.
+ *
+ * The integers of the FILL and PALETTE payloads are big endian, as the
+ * header ones; the ZLIB payload inflates to little endian xRGB pixels.
+ */
+
+#define PALETTE_MAX     256
+#define PALETTE_HASH    1024 /* power of 2, several times PALETTE_MAX */
+#define PALETTE_USED    0x1000000
+
+typedef struct Palette {
+    uint32_t keys[PALETTE_HASH]; /* color | PALETTE_USED, 0 if free */
+    uint8_t  index[PALETTE_HASH];
+    uint32_t colors[PALETTE_MAX];
+    uint16_t slots[PALETTE_MAX]; /* of colors[i], to reset keys cheaply */
+    int      ncolors;
+} Palette;
+
+/* one per encoder thread, reused for every update */
+Palette *android_palette_new(void)
+{
+    return spice_new0(Palette, 1);
+}
+
+void android_palette_free(Palette *palette)
+{
+    free(palette);
+}
+
+static void palette_reset(Palette *palette)
+{
+    int i;
+
+    for (i = 0; i < palette->ncolors; i++)
+        palette->keys[palette->slots[i]] = 0;
+    palette->ncolors = 0;
+}
+
+static inline int palette_slot(Palette *palette, uint32_t color)
+{
+    uint32_t key = color | PALETTE_USED;
+    int slot = (color * 2654435761u) >> 22;
+
+    while (palette->keys[slot] != 0 && palette->keys[slot] != key)
+        slot = (slot + 1) & (PALETTE_HASH - 1);
+    return slot;
+}
+
+/* returns FALSE once the palette overflows */
+static inline gboolean palette_add(Palette *palette, uint32_t color)
+{
+    int slot = palette_slot(palette, color);
+
+    if (palette->keys[slot] != 0)
+        return TRUE;
+    if (palette->ncolors == PALETTE_MAX)
+        return FALSE;
+    palette->keys[slot] = color | PALETTE_USED;
+    palette->index[slot] = palette->ncolors;
+    palette->slots[palette->ncolors] = slot;
+    palette->colors[palette->ncolors++] = color;
+    return TRUE;
+}
+
+static inline uint8_t *put_uint32(uint8_t *out, uint32_t v)
+{
+    *out++ = v >> 24;
+    *out++ = v >> 16;
+    *out++ = v >> 8;
+    *out++ = v;
+    return out;
+}
+
+static int encode_fill(uint32_t color, uint8_t **io_ptr)
+{
+    *io_ptr = spice_malloc(4);
+    put_uint32(*io_ptr, color);
+    return 4;
+}
+
+/* int ncolors, ncolors xRGB colors, then (index, length - 1) byte pairs */
+static int encode_palette(Palette *palette, uint32_t *pixels, int n,
+                          uint8_t **io_ptr)
+{
+    uint8_t *out;
+    int i, run, slot;
+
+    out = *io_ptr = spice_malloc(4 + palette->ncolors * 4 + n * 2);
+    out = put_uint32(out, palette->ncolors);
+    for (i = 0; i < palette->ncolors; i++)
+        out = put_uint32(out, palette->colors[i]);
+
+    for (i = 0; i < n; i += run) {
+        for (run = 1; run < 256 && i + run < n && pixels[i + run] == pixels[i]; run++)
+            ;
+        slot = palette_slot(palette, pixels[i]);
+        *out++ = palette->index[slot];
+        *out++ = run - 1;
+    }
+    return out - *io_ptr;
+}
+
+static int encode_zlib(uint32_t *pixels, int n, uint8_t **io_ptr)
+{
+    uLongf size = compressBound(n * 4);
+
+    *io_ptr = spice_malloc(size);
+    if (compress2(*io_ptr, &size, (Bytef *)pixels, n * 4, Z_BEST_SPEED) != Z_OK) {
+        free(*io_ptr);
+        *io_ptr = NULL;
+        return 0;
+    }
+    return size;
+}
+
+/* @pixels holds show->width * show->height xRGB pixels, without padding */
+void android_encode(JpegEncoder *encoder, Palette *palette, AndroidShow *show,
+                    uint8_t *pixels)
+{
+    uint32_t *src = (uint32_t *)pixels;
+    int i, n, flat;
+    gboolean few_colors = TRUE;
+
+    n = show->width * show->height;
+    palette_reset(palette);
+
+    for (i = 0, flat = 0; i < n; i++) {
+        src[i] &= 0xffffff;
+        if (i > 0 && src[i] == src[i - 1]) {
+            flat++;
+            continue;
+        }
+        if (few_colors)
+            few_colors = palette_add(palette, src[i]);
+    }
+
+    show->data = NULL;
+    show->size = 0;
+    if (few_colors && palette->ncolors == 1) {
+        show->type = ANDROID_SHOW_FILL;
+        show->size = encode_fill(src[0], &show->data);
+    } else if (few_colors) {
+        show->type = ANDROID_SHOW_PALETTE;
+        show->size = encode_palette(palette, src, n, &show->data);
+    } else if (flat * 2 > n) {
+        show->type = ANDROID_SHOW_ZLIB;
+        show->size = encode_zlib(src, n, &show->data);
+    }
+
+    if (show->data == NULL) {
+        show->type = ANDROID_SHOW;
+        show->size = jpeg_encode(encoder, 75, show->width, show->height,
+                                 pixels, show->width * 4, &show->data);
+    }
+}
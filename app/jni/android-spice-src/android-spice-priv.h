@@ -26,6 +26,7 @@ G_BEGIN_DECLS
 
 #include "spice-widget.h"
 #include "spice-common.h"
+#include "region.h"
 
 #define SPICE_DISPLAY_GET_PRIVATE(obj)                                  \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj), SPICE_TYPE_DISPLAY, spice_display))
@@ -41,6 +42,7 @@ struct spice_display {
     /* state */
     enum SpiceSurfaceFmt    format;
     gint                    width, height, stride;
+    gint                    stride_origin; /* of data_origin */
     gint                    shmid;
     gpointer                data_origin; /* the original display image data */
     gpointer                data; /* converted if necessary to 32 bits */
@@ -75,6 +77,23 @@ struct spice_display {
     uint32_t                key_state[512 / 32];
     gboolean                *activeseq; /* the currently pressed keys */
     gint                    mark;
+
+    /* damage accumulated between two frame clock ticks */
+    QRegion                 damage;
+    guint                   frame_id;
+    guint                   frame_interval;
+    bool                    shm_announce; /* ANDROID_SHM_CREATE not sent yet */
+
+    /* content of the tiles last sent to Java, and of its cache slots */
+    guint64                 *tile_hash;
+    gint                    tiles_x, tiles_y;
+    guint64                 slot_hash[ANDROID_TILE_SLOTS];
+    guint                   slot_gen[ANDROID_TILE_SLOTS];
+    gint                    slot_ack[ANDROID_TILE_SLOTS]; /* set by the input thread */
+    gint                    slot_next;
+    guint                   flush_gen;
+    gint                    *tile_copies, ntile_copies; /* (slot, x, y) */
+    gint                    *tile_stores, ntile_stores;
 };
 
 int      spicex_image_create                 (SpiceDisplay *display);
@@ -25,11 +25,16 @@
 #include "android-spice.h"
 #include "android-spice-priv.h"
 #include "androidkeymap.c"
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 G_DEFINE_TYPE(SpiceDisplay, spice_display, SPICE_TYPE_CHANNEL);
 static SpiceDisplay* android_display;
 void android_show(spice_display* d,gint x,gint y,gint w,gint h);
-int android_drop_show;
+void android_show_shared(AndroidEventType type,gint x,gint y,gint w,gint h);
 
 static void disconnect_main(SpiceDisplay *display);
 static void disconnect_display(SpiceDisplay *display);
@@ -108,6 +113,9 @@ static void spice_display_init(SpiceDisplay *display)
     d = display->priv = SPICE_DISPLAY_GET_PRIVATE(display);
     memset(d, 0, sizeof(*d));
     d->have_mitshm = true;
+    d->shmid = -1;
+    d->frame_interval = ANDROID_FRAME_INTERVAL;
+    region_init(&d->damage);
 }
 
 
@@ -127,13 +135,94 @@ static void spice_display_init(SpiceDisplay *display)
 
 #define CONVERT_0555_TO_8888(s) (CONVERT_0555_TO_0888(s) | 0xff000000)
 
-static gboolean do_color_convert(SpiceDisplay *display,
+/*
+ * Both conversions only move and replicate bits, so the color of a pixel
+ * is the OR of the colors of its low and high bytes: two 256 entries
+ * tables per format are enough for the scalar path.
+ */
+static guint32 convert_lut[2][2][256]; /* [565][high byte][byte] */
+
+static void convert_lut_init(void)
+{
+    int i;
+
+    if (convert_lut[0][1][0xff] != 0)
+	return;
+    for (i = 0; i < 256; i++) {
+	convert_lut[0][0][i] = CONVERT_0555_TO_0888(i);
+	convert_lut[0][1][i] = CONVERT_0555_TO_0888(i << 8);
+	convert_lut[1][0][i] = CONVERT_0565_TO_0888(i);
+	convert_lut[1][1][i] = CONVERT_0565_TO_0888(i << 8);
+    }
+}
+
+static void convert_line(guint32 *dest, const guint16 *src, int n, int rgb565)
+{
+    const guint32 *lo = convert_lut[rgb565][0];
+    const guint32 *hi = convert_lut[rgb565][1];
+    int i = 0;
+
+#if defined(__ARM_NEON__)
+    for (; i + 8 <= n; i += 8) {
+	uint16x8_t s = vld1q_u16(src + i);
+	uint16x8_t r, g, b;
+	uint8x8x4_t bgrx;
+
+	if (rgb565) {
+	    r = vshrq_n_u16(s, 11);
+	    g = vandq_u16(vshrq_n_u16(s, 5), vdupq_n_u16(0x3f));
+	    g = vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4));
+	} else {
+	    r = vandq_u16(vshrq_n_u16(s, 10), vdupq_n_u16(0x1f));
+	    g = vandq_u16(vshrq_n_u16(s, 5), vdupq_n_u16(0x1f));
+	    g = vorrq_u16(vshlq_n_u16(g, 3), vshrq_n_u16(g, 2));
+	}
+	r = vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2));
+	b = vandq_u16(s, vdupq_n_u16(0x1f));
+	b = vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2));
+
+	bgrx.val[0] = vmovn_u16(b);
+	bgrx.val[1] = vmovn_u16(g);
+	bgrx.val[2] = vmovn_u16(r);
+	bgrx.val[3] = vdup_n_u8(0);
+	vst4_u8((uint8_t *)(dest + i), bgrx);
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+	__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+	__m128i five = _mm_set1_epi16(0x1f);
+	__m128i r, g, b;
+
+	if (rgb565) {
+	    r = _mm_srli_epi16(s, 11);
+	    g = _mm_and_si128(_mm_srli_epi16(s, 5), _mm_set1_epi16(0x3f));
+	    g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+	} else {
+	    r = _mm_and_si128(_mm_srli_epi16(s, 10), five);
+	    g = _mm_and_si128(_mm_srli_epi16(s, 5), five);
+	    g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+	}
+	r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+	b = _mm_and_si128(s, five);
+	b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+	/* 16 bits lanes B | G << 8 and R, interleaved into xRGB */
+	b = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+	_mm_storeu_si128((__m128i *)(dest + i), _mm_unpacklo_epi16(b, r));
+	_mm_storeu_si128((__m128i *)(dest + i + 4), _mm_unpackhi_epi16(b, r));
+    }
+#endif
+
+    for (; i < n; i++)
+	dest[i] = lo[src[i] & 0xff] | hi[src[i] >> 8];
+}
+
+static gboolean do_color_convert(spice_display *d,
 	gint x, gint y, gint w, gint h)
 {
-    spice_display *d = SPICE_DISPLAY_GET_PRIVATE(display);
-    int i, j, maxy, maxx, miny, minx;
-    guint32 *dest = d->data;
-    guint16 *src = d->data_origin;
+    int j, maxy, maxx, miny, minx, rgb565;
+    guint8 *dest = d->data;
+    guint8 *src = d->data_origin;
 
     if (!d->convert)
 	return true;
@@ -145,28 +234,17 @@ static gboolean do_color_convert(SpiceDisplay *display,
     minx = MAX(x, 0);
     maxy = MIN(y + h, d->height);
     maxx = MIN(x + w, d->width);
+    if (minx >= maxx)
+	return true;
 
-    dest +=  (d->stride / 4) * miny;
-    src += (d->stride / 2) * miny;
-
-    if (d->format == SPICE_SURFACE_FMT_16_555) {
-	for (j = miny; j < maxy; j++) {
-	    for (i = minx; i < maxx; i++) {
-		dest[i] = CONVERT_0555_TO_0888(src[i]);
-	    }
-
-	    dest += d->stride / 4;
-	    src += d->stride / 2;
-	}
-    } else if (d->format == SPICE_SURFACE_FMT_16_565) {
-	for (j = miny; j < maxy; j++) {
-	    for (i = minx; i < maxx; i++) {
-		dest[i] = CONVERT_0565_TO_0888(src[i]);
-	    }
-
-	    dest += d->stride / 4;
-	    src += d->stride / 2;
-	}
+    convert_lut_init();
+    rgb565 = (d->format == SPICE_SURFACE_FMT_16_565);
+    dest += d->stride * miny + minx * 4;
+    src += d->stride_origin * miny + minx * 2;
+    for (j = miny; j < maxy; j++) {
+	convert_line((guint32 *)dest, (guint16 *)src, maxx - minx, rgb565);
+	dest += d->stride;
+	src += d->stride_origin;
     }
 
     return true;
@@ -286,13 +364,297 @@ gboolean button_event(AndroidEventButton *button)
     return true;
 }
 
-void show_event(spice_display* d,gint x,gint y,gint w, gint h)
+/* main context, where the counters are updated */
+static gboolean send_stats(gpointer data)
 {
-    //drop some tiny but annoying updating caused by QXL to 
-    //low the data flow for android.
-    if(!(android_drop_show&(w*h < d->width)))
-	android_show(d, x, y, w, h);
-    android_drop_show = (w*h < d->width);
+    spice_display* d;
+    gchar* json;
+
+    if (!android_display)
+	return false;
+    if (android_show_free() < 1) {
+	g_timeout_add(ANDROID_FRAME_INTERVAL, send_stats, NULL);
+	return false;
+    }
+    d = SPICE_DISPLAY_GET_PRIVATE(android_display);
+    json = spice_session_msg_stats_to_json(d->session);
+    android_show_stats(json);
+    g_free(json);
+    return false;
+}
+
+/* input thread */
+gboolean stats_event(void)
+{
+    g_idle_add(send_stats, NULL);
+    return true;
+}
+
+/* input thread: Java cached lossless pixels in @slot for store @gen */
+gboolean tile_ack_event(gint slot, gint gen)
+{
+    spice_display *d;
+
+    if (!android_display || slot < 0 || slot >= ANDROID_TILE_SLOTS)
+	return false;
+    d = SPICE_DISPLAY_GET_PRIVATE(android_display);
+    g_atomic_int_set(&d->slot_ack[slot], gen);
+    return true;
+}
+
+/*
+ * Without a shared framebuffer, the damage is also checked tile by tile
+ * against what Java already got: tiles whose content didn't change
+ * actually are dropped from the damage, and tiles whose new content is
+ * in one of the Java cache slots are sent as ANDROID_TILE_COPY instead
+ * of being encoded. Other changed full tiles are stored in a slot,
+ * reused round robin, once the updates are drawn (ANDROID_TILE_STORE).
+ * Whether a tile ends up drawn from JPEG is only known once encoded, so
+ * a slot is copied from only after Java acknowledged that it cached
+ * lossless pixels there for that store.
+ */
+static void tiles_free(spice_display* d)
+{
+    free(d->tile_hash);
+    free(d->tile_copies);
+    free(d->tile_stores);
+    d->tile_hash = NULL;
+    d->tile_copies = NULL;
+    d->tile_stores = NULL;
+    d->tiles_x = d->tiles_y = 0;
+    memset(d->slot_hash, 0, sizeof(d->slot_hash));
+}
+
+static void tiles_alloc(spice_display* d)
+{
+    int n;
+
+    tiles_free(d);
+    d->tiles_x = (d->width + ANDROID_TILE_SIZE - 1) / ANDROID_TILE_SIZE;
+    d->tiles_y = (d->height + ANDROID_TILE_SIZE - 1) / ANDROID_TILE_SIZE;
+    n = d->tiles_x * d->tiles_y;
+    d->tile_hash = spice_new0(guint64, n);
+    d->tile_copies = spice_new(gint, n * 3);
+    d->tile_stores = spice_new(gint, n * 3);
+}
+
+static void tile_rect(spice_display* d, int tx, int ty, SpiceRect* r)
+{
+    r->left = tx * ANDROID_TILE_SIZE;
+    r->top = ty * ANDROID_TILE_SIZE;
+    r->right = MIN(r->left + ANDROID_TILE_SIZE, d->width);
+    r->bottom = MIN(r->top + ANDROID_TILE_SIZE, d->height);
+}
+
+/* FNV-1a over the xRGB words, never 0 which marks unknown content */
+static guint64 tile_digest(spice_display* d, SpiceRect* r)
+{
+    guint64 h = 14695981039346656037ULL;
+    uint32_t* line;
+    int x, y;
+
+    for (y = r->top; y < r->bottom; y++) {
+	line = (uint32_t*)((uint8_t*)d->data + y * d->stride) + r->left;
+	for (x = 0; x < r->right - r->left; x++) {
+	    h ^= line[x] & 0xffffff;
+	    h *= 1099511628211ULL;
+	}
+    }
+    return h | 1;
+}
+
+static int tile_slot_find(spice_display* d, guint64 h)
+{
+    int i;
+
+    for (i = 0; i < ANDROID_TILE_SLOTS; i++)
+	if (d->slot_hash[i] == h)
+	    return i;
+    return -1;
+}
+
+static void tiles_filter(spice_display* d)
+{
+    pixman_box32_t box;
+    SpiceRect r;
+    guint64 h;
+    int tx, ty, t, slot;
+    gint* triple;
+
+    d->flush_gen++;
+    d->ntile_copies = d->ntile_stores = 0;
+    for (ty = 0; ty < d->tiles_y; ty++) {
+	for (tx = 0; tx < d->tiles_x; tx++) {
+	    tile_rect(d, tx, ty, &r);
+	    box.x1 = r.left;
+	    box.y1 = r.top;
+	    box.x2 = r.right;
+	    box.y2 = r.bottom;
+	    if (pixman_region32_contains_rectangle(&d->damage, &box) == PIXMAN_REGION_OUT)
+		continue;
+
+	    t = ty * d->tiles_x + tx;
+	    h = tile_digest(d, &r);
+	    if (h == d->tile_hash[t]) {
+		region_remove(&d->damage, &r);
+		continue;
+	    }
+	    d->tile_hash[t] = h;
+	    if (r.right - r.left != ANDROID_TILE_SIZE ||
+		r.bottom - r.top != ANDROID_TILE_SIZE)
+		continue;
+
+	    slot = tile_slot_find(d, h);
+	    if (slot >= 0 && d->slot_gen[slot] != d->flush_gen &&
+		    g_atomic_int_get(&d->slot_ack[slot]) == (gint)d->slot_gen[slot]) {
+		/* copies are sent before the stores of this flush */
+		region_remove(&d->damage, &r);
+		triple = d->tile_copies + d->ntile_copies++ * 3;
+	    } else if (slot < 0) {
+		slot = d->slot_next;
+		d->slot_next = (slot + 1) % ANDROID_TILE_SLOTS;
+		d->slot_hash[slot] = h;
+		d->slot_gen[slot] = d->flush_gen;
+		triple = d->tile_stores + d->ntile_stores++ * 3;
+	    } else {
+		continue;
+	    }
+	    triple[0] = slot;
+	    triple[1] = r.left;
+	    triple[2] = r.top;
+	}
+    }
+}
+
+/* the flush didn't happen: forget what tiles_filter() assumed sent */
+static void tiles_rollback(spice_display* d)
+{
+    pixman_box32_t box;
+    SpiceRect r;
+    int tx, ty, i;
+
+    for (i = 0; i < d->ntile_copies; i++) {
+	tile_rect(d, d->tile_copies[i * 3 + 1] / ANDROID_TILE_SIZE,
+		d->tile_copies[i * 3 + 2] / ANDROID_TILE_SIZE, &r);
+	region_add(&d->damage, &r);
+    }
+    for (i = 0; i < d->ntile_stores; i++)
+	d->slot_hash[d->tile_stores[i * 3]] = 0;
+    d->ntile_copies = d->ntile_stores = 0;
+
+    for (ty = 0; ty < d->tiles_y; ty++) {
+	for (tx = 0; tx < d->tiles_x; tx++) {
+	    tile_rect(d, tx, ty, &r);
+	    box.x1 = r.left;
+	    box.y1 = r.top;
+	    box.x2 = r.right;
+	    box.y2 = r.bottom;
+	    if (pixman_region32_contains_rectangle(&d->damage, &box) != PIXMAN_REGION_OUT)
+		d->tile_hash[ty * d->tiles_x + tx] = 0;
+	}
+    }
+}
+
+/*
+ * Every rectangle of the coalesced damage is sent on its own, unless the
+ * region got so fragmented that the per-image overhead would outweigh
+ * the saved pixels, or wouldn't fit in the output ring at once: then its
+ * bounding box is sent instead.
+ * When the output socket lags behind and can't take the whole frame,
+ * nothing is sent and the damage keeps accumulating until the next tick.
+ */
+static gboolean damage_flush(spice_display* d)
+{
+    pixman_box32_t *boxes;
+    int i, n, needed;
+
+    if (region_is_empty(&d->damage))
+	return TRUE;
+    if (d->convert) {
+	boxes = pixman_region32_rectangles(&d->damage, &n);
+	for (i = 0; i < n; i++)
+	    do_color_convert(d, boxes[i].x1, boxes[i].y1,
+		    boxes[i].x2 - boxes[i].x1, boxes[i].y2 - boxes[i].y1);
+    }
+    if (d->tile_hash != NULL)
+	tiles_filter(d);
+
+    boxes = pixman_region32_rectangles(&d->damage, &n);
+    needed = d->shm_announce ? 1 : 0;
+    for (i = 0; i < n; i++)
+	needed += d->shmid >= 0 ? 1 : android_show_stripes(
+		boxes[i].x2 - boxes[i].x1, boxes[i].y2 - boxes[i].y1);
+    if (n > ANDROID_MAX_DAMAGE_RECTS || needed > ANDROID_SHOW_RING_SIZE) {
+	boxes = pixman_region32_extents(&d->damage);
+	n = 1;
+	needed = (d->shm_announce ? 1 : 0) + (d->shmid >= 0 ? 1 :
+		android_show_stripes(boxes->x2 - boxes->x1, boxes->y2 - boxes->y1));
+    }
+    needed += (d->ntile_copies ? 1 : 0) + (d->ntile_stores ? 1 : 0);
+    if (android_show_free() < needed) {
+	if (d->tile_hash != NULL)
+	    tiles_rollback(d);
+	return FALSE;
+    }
+
+    if (d->shm_announce) {
+	android_show_shared(ANDROID_SHM_CREATE, d->stride, 0, d->width, d->height);
+	d->shm_announce = false;
+    }
+    for (i = 0; i < n; i++) {
+	if (d->shmid >= 0)
+	    android_show_shared(ANDROID_SHM_SHOW, boxes[i].x1, boxes[i].y1,
+		    boxes[i].x2 - boxes[i].x1, boxes[i].y2 - boxes[i].y1);
+	else
+	    android_show(d, boxes[i].x1, boxes[i].y1,
+		    boxes[i].x2 - boxes[i].x1, boxes[i].y2 - boxes[i].y1);
+    }
+    if (d->ntile_copies)
+	android_show_tiles(ANDROID_TILE_COPY, 0, d->tile_copies, d->ntile_copies);
+    if (d->ntile_stores)
+	android_show_tiles(ANDROID_TILE_STORE, d->flush_gen,
+		d->tile_stores, d->ntile_stores);
+    d->ntile_copies = d->ntile_stores = 0;
+    region_clear(&d->damage);
+    return TRUE;
+}
+
+static gboolean frame_tick(gpointer data)
+{
+    spice_display* d = data;
+
+    if (region_is_empty(&d->damage) || d->data == NULL) {
+	region_clear(&d->damage);
+	d->frame_id = 0;
+	return FALSE;
+    }
+    damage_flush(d);
+    return TRUE;
+}
+
+static void damage_reset(spice_display* d)
+{
+    if (d->frame_id) {
+	g_source_remove(d->frame_id);
+	d->frame_id = 0;
+    }
+    region_clear(&d->damage);
+}
+
+static void damage_add(spice_display* d,gint x,gint y,gint w, gint h)
+{
+    SpiceRect r;
+
+    r.left = MAX(x, 0);
+    r.top = MAX(y, 0);
+    r.right = MIN(x + w, d->width);
+    r.bottom = MIN(y + h, d->height);
+    if (r.left >= r.right || r.top >= r.bottom)
+	return;
+
+    region_add(&d->damage, &r);
+    if (d->frame_id == 0)
+	d->frame_id = g_timeout_add(d->frame_interval, frame_tick, d);
 }
 
 /* ---------------------------------------------------------------- */
@@ -307,10 +669,20 @@ static void primary_create(SpiceChannel *channel, gint format,
     spice_display *d = SPICE_DISPLAY_GET_PRIVATE(display);
     gboolean set_display = FALSE;
 
+    damage_reset(d);
+    if (d->convert)
+	free(d->data);
     d->format = format;
-    d->stride = stride;
+    d->stride_origin = d->stride = stride;
     d->shmid  = shmid;
     d->data_origin = d->data = imgdata;
+    /* 16 bits guests: Java and the encoders get a 32 bits copy */
+    d->convert = (format == SPICE_SURFACE_FMT_16_555 ||
+	    format == SPICE_SURFACE_FMT_16_565);
+    if (d->convert) {
+	d->stride = width * 4;
+	d->data = spice_malloc(d->stride * height);
+    }
 
     SPICE_DEBUG("%s:%s:%d:%p\n\t%d:%d\n",__FILE__, __FUNCTION__,__LINE__,(char*)d->data,width,height);
     if (d->width != width || d->height != height) {
@@ -321,6 +693,13 @@ static void primary_create(SpiceChannel *channel, gint format,
 	if (!d->resize_guest_enable) {
 	}
     }
+    d->shm_announce = (shmid >= 0);
+    if (shmid < 0)
+	tiles_alloc(d);
+    else
+	tiles_free(d);
+    /* Java composites on top of what it has: give it the whole new surface */
+    damage_add(d, 0, 0, width, height);
 }
 
 static void primary_destroy(SpiceChannel *channel, gpointer data)
@@ -329,11 +708,17 @@ static void primary_destroy(SpiceChannel *channel, gpointer data)
     spice_display *d = SPICE_DISPLAY_GET_PRIVATE(display);
 
     //spicex_image_destroy(display);
+    damage_reset(d);
+    tiles_free(d);
+    if (d->convert)
+	free(d->data);
+    d->convert = false;
     d->format = 0;
     d->width  = 0;
     d->height = 0;
     d->stride = 0;
-    d->shmid  = 0;
+    d->stride_origin = 0;
+    d->shmid  = -1;
     d->data   = 0;
     d->data_origin = 0;
 }
@@ -342,11 +727,10 @@ static void invalidate(SpiceChannel *channel,
 	gint x, gint y, gint w, gint h, gpointer data)
 {
     SpiceDisplay *display = data;
-    if (!do_color_convert(display, x, y, w, h))
-	return;
-
     spice_display *d = SPICE_DISPLAY_GET_PRIVATE(display);
-    show_event(d, x, y, w, h);
+
+    /* converted at flush time, once for all the draws of the frame */
+    damage_add(d, x, y, w, h);
     //fprintf(stderr,"%s:%s:%d:%p\n\t%d:%d:%d:%d\n",__FILE__,
     //__FUNCTION__,__LINE__,(char*)data,w,h,x,y);
     //write_ppm_32(d->data);
@@ -357,7 +741,9 @@ static void mark(SpiceChannel *channel, gint mark, gpointer data)
     SpiceDisplay *display = data;
     spice_display *d = SPICE_DISPLAY_GET_PRIVATE(display);
     d->mark = mark;
-    //show_event(d, x, y, w, h);
+    /* the server marks a complete frame: show it without waiting */
+    if (mark && !region_is_empty(&d->damage))
+	damage_flush(d);
 }
 
 
@@ -464,6 +850,21 @@ static void channel_destroy(SpiceSession *s, SpiceChannel *channel, gpointer dat
     return;
 }
 
+/**
+ * spice_display_set_frame_interval:
+ * @display: a #SpiceDisplay
+ * @msecs: period of the frame clock, in milliseconds
+ *
+ * Sets how long invalidated areas are accumulated before being sent
+ * to Java as one batched update.
+ **/
+void spice_display_set_frame_interval(SpiceDisplay *display, guint msecs)
+{
+    spice_display *d = SPICE_DISPLAY_GET_PRIVATE(display);
+
+    d->frame_interval = MAX(msecs, 1);
+}
+
 /**
  * spice_display_new:
  * @session: a #SpiceSession
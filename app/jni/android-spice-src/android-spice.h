@@ -74,6 +74,15 @@ typedef enum
     ANDROID_BUTTON_PRESS = 3,
     ANDROID_BUTTON_RELEASE = 4,
     ANDROID_SHOW = 5,
+    ANDROID_SHM_CREATE = 6,
+    ANDROID_SHM_SHOW = 7,
+    ANDROID_SHOW_FILL = 8,
+    ANDROID_SHOW_PALETTE = 9,
+    ANDROID_SHOW_ZLIB = 10,
+    ANDROID_TILE_COPY = 11,
+    ANDROID_TILE_STORE = 12,
+    ANDROID_STATS = 13,
+    ANDROID_TRACE_DUMP = 14,
 } AndroidEventType;
 struct _AndroidEventKey
 {
@@ -90,6 +99,21 @@ struct _AndroidEventButton
 };
 typedef struct _AndroidEventButton AndroidEventButton;
 
+/*
+ * For ANDROID_SHOW*, size bytes of JPEG, or of the encoding described in
+ * android-codec.c, follow the header. The shared framebuffer messages
+ * carry no data: size is their sequence number, and the x of
+ * ANDROID_SHM_CREATE is the stride of the mapped surface in bytes.
+ * ANDROID_TILE_COPY and ANDROID_TILE_STORE carry (slot, x, y) triples of
+ * ints: draw the cached tile at (x, y), or cache the tile at (x, y).
+ * The x of ANDROID_TILE_STORE is a generation: Java answers every tile it
+ * cached from lossless pixels with an input ANDROID_TILE_STORE message
+ * carrying (slot, generation), and only such slots are copied from.
+ * ANDROID_STATS, the answer to the input message of the same type, carries
+ * the JSON of spice_session_msg_stats_to_json().
+ * The ANDROID_TRACE_DUMP input message gets no answer: the trace records
+ * go to the android log, see spice_trace_dump().
+ */
 struct _AndroidShow
 {
   AndroidEventType type;
@@ -109,18 +133,26 @@ struct _AndroidMsg
 };
 typedef struct _AndroidMsg AndroidMsg;
 
-enum
-{
-    ANDROID_TASK_IDLE = 0,
-    ANDROID_TASK_SHOW = 1,
-    ANDROID_TASK_OVER = 2,
-};
+/* updates queued for the output socket, must be a power of 2 */
+#define ANDROID_SHOW_RING_SIZE 16
+/* JPEG encoder threads, and the smallest stripe worth its own thread */
+#define ANDROID_MAX_ENCODERS 4
+#define ANDROID_MIN_STRIPE_HEIGHT 64
+
 enum
 {
     ANDROID_BUTTON1_MASK  = 1 << 8,
     ANDROID_BUTTON2_MASK  = 1 << 9,
     ANDROID_BUTTON3_MASK  = 1 << 10,
 };
+/* default period of the frame clock flushing the damage to Java, in ms */
+#define ANDROID_FRAME_INTERVAL 40
+/* above this many rects, the bounding box of the damage is sent instead */
+#define ANDROID_MAX_DAMAGE_RECTS 16
+/* unchanged content is detected per tile, and Java caches that many tiles */
+#define ANDROID_TILE_SIZE 64
+#define ANDROID_TILE_SLOTS 256
+
 enum
 {
     INT=1,
@@ -129,10 +161,24 @@ enum
 
 int android_spice_input();
 int android_spice_output();
+void android_output_init(void);
+int android_show_free(void);
+int android_show_stripes(gint w, gint h);
+void android_show_tiles(AndroidEventType type, gint gen, gint *triples, gint n);
+void android_show_stats(const gchar *json);
+gboolean stats_event(void);
+gboolean tile_ack_event(gint slot, gint gen);
+struct JpegEncoder;
+struct Palette;
+struct Palette *android_palette_new(void);
+void android_palette_free(struct Palette *palette);
+void android_encode(struct JpegEncoder *encoder, struct Palette *palette,
+	AndroidShow *show, uint8_t *pixels);
 
 GType	        spice_display_get_type(void);
 
 SpiceDisplay* spice_display_new(SpiceSession *session, int id);
+void spice_display_set_frame_interval(SpiceDisplay *display, guint msecs);
 void spice_display_send_keys(SpiceDisplay *display, const guint *keyvals,
 	int nkeyvals, SpiceDisplayKeyEvent kind);
 
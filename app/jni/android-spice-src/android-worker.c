@@ -28,12 +28,36 @@
 #include "jpeg_encoder.h"
 
 extern GMainLoop* volatile android_mainloop;
-extern JpegEncoder* volatile android_jpeg_encoder;
-extern pthread_mutex_t android_mutex;  
-extern pthread_cond_t android_cond;  
-extern volatile int android_task_ready;
-extern volatile int android_task;
-volatile AndroidShow android_show_display;
+
+/*
+ * Single producer (the main loop, in android_show*()) single consumer
+ * (android_spice_output()) ring of the updates waiting for the socket.
+ * The producer never waits: when the ring is full the damage simply
+ * stays in the display region and is encoded again, from the newest
+ * pixels, once the socket caught up.
+ *
+ * The producer only snapshots the pixels of each stripe: the encoding
+ * is done by a pool of workers, each with its own JpegEncoder, which
+ * take the queued jobs in order but complete them in any order. The
+ * consumer still sends them in ring order, as soon as the oldest one is
+ * ready. The mutex only guards the sleeps, never the ring itself.
+ */
+typedef struct AndroidShowJob {
+    AndroidShow show;
+    uint8_t *pixels; /* stripe snapshot to encode, NULL if none */
+    volatile gint ready;
+} AndroidShowJob;
+
+static AndroidShowJob android_show_ring[ANDROID_SHOW_RING_SIZE];
+static volatile gint android_show_head; /* written by the producer only */
+static volatile gint android_show_tail; /* written by the consumer only */
+static gint android_encode_next; /* guarded by android_output_mutex */
+static volatile gint android_output_over;
+static pthread_mutex_t android_output_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t android_output_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t android_encoders[ANDROID_MAX_ENCODERS];
+static int android_encoders_count = 1; /* set before the threads start */
+static guint android_show_seq;
 gboolean key_event(AndroidEventKey* key);
 gboolean button_event(AndroidEventButton *button);
 
@@ -56,18 +80,122 @@ void error(const char *msg)
     SPICE_DEBUG("msg:%s",msg);
     exit(0);
 }
-void android_send_task(int task)
+
+/* producer side: number of updates that can be queued without waiting */
+int android_show_free(void)
+{
+    return ANDROID_SHOW_RING_SIZE -
+	((guint)g_atomic_int_get(&android_show_head) - (guint)g_atomic_int_get(&android_show_tail));
+}
+
+static AndroidShowJob* android_show_slot(void)
+{
+    return &android_show_ring[android_show_head & (ANDROID_SHOW_RING_SIZE - 1)];
+}
+
+static void android_output_wakeup(void)
+{
+    pthread_mutex_lock(&android_output_mutex);
+    pthread_cond_broadcast(&android_output_cond);
+    pthread_mutex_unlock(&android_output_mutex);
+}
+
+static void android_show_push(void)
+{
+    g_atomic_int_set(&android_show_head, android_show_head + 1);
+    android_output_wakeup();
+}
+
+static void android_output_stop(void)
+{
+    g_atomic_int_set(&android_output_over, 1);
+    android_output_wakeup();
+}
+
+/* consumer side: sleeps until the oldest update is encoded, NULL once over */
+static AndroidShow* android_show_pop(void)
+{
+    AndroidShowJob* job = &android_show_ring[android_show_tail & (ANDROID_SHOW_RING_SIZE - 1)];
+
+    pthread_mutex_lock(&android_output_mutex);
+    while ((g_atomic_int_get(&android_show_head) == android_show_tail ||
+		!g_atomic_int_get(&job->ready)) &&
+	    !g_atomic_int_get(&android_output_over))
+	pthread_cond_wait(&android_output_cond, &android_output_mutex);
+    pthread_mutex_unlock(&android_output_mutex);
+
+    if (g_atomic_int_get(&android_output_over))
+	return NULL;
+    return &job->show;
+}
+
+static void android_show_release(void)
+{
+    g_atomic_int_set(&android_show_tail, android_show_tail + 1);
+}
+
+static void* android_encoder_run(void* arg)
+{
+    JpegEncoder* encoder = jpeg_encoder_create();
+    struct Palette* palette = android_palette_new();
+    AndroidShowJob* job;
+    AndroidShow* show;
+
+    while (1) {
+	pthread_mutex_lock(&android_output_mutex);
+	while (android_encode_next == g_atomic_int_get(&android_show_head) &&
+		!g_atomic_int_get(&android_output_over))
+	    pthread_cond_wait(&android_output_cond, &android_output_mutex);
+	if (g_atomic_int_get(&android_output_over)) {
+	    pthread_mutex_unlock(&android_output_mutex);
+	    break;
+	}
+	job = &android_show_ring[android_encode_next++ & (ANDROID_SHOW_RING_SIZE - 1)];
+	pthread_mutex_unlock(&android_output_mutex);
+
+	if (job->pixels) {
+	    show = &job->show;
+	    android_encode(encoder, palette, show, job->pixels);
+	    free(job->pixels);
+	    job->pixels = NULL;
+	    SPICE_DEBUG("ANDROID_SHOW(%d) for %p:w--%d:h--%d:x--%d:y--%d:size--%d",
+		    show->type, (char*)show->data, show->width, show->height,
+		    show->x, show->y, show->size);
+	}
+	g_atomic_int_set(&job->ready, 1);
+	android_output_wakeup();
+    }
+
+    jpeg_encoder_destroy(encoder);
+    android_palette_free(palette);
+    return NULL;
+}
+
+/* main thread, before the I/O threads are created */
+void android_output_init(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    android_encoders_count = CLAMP(n, 1, ANDROID_MAX_ENCODERS);
+}
+
+static void android_encoders_start(void)
+{
+    int i;
+
+    for (i = 0; i < android_encoders_count; i++)
+	pthread_create(&android_encoders[i], NULL, android_encoder_run, NULL);
+}
+
+static void android_encoders_stop(void)
 {
-    while(!android_task_ready);  
-    SPICE_DEBUG("send task:%d\n",task);
-    pthread_mutex_lock(&android_mutex);  
-    android_task_ready = 0;  
-    android_task = task;  
-    pthread_cond_signal(&android_cond);  
-    pthread_mutex_unlock(&android_mutex);  
-    while(android_task);  
-    SPICE_DEBUG("send task done:%d\n",task);
+    int i;
+
+    android_output_stop();
+    for (i = 0; i < android_encoders_count; i++)
+	pthread_join(android_encoders[i], NULL);
 }
+
 int msg_recv_handle(int sockfd,char* buf)
 {
     int n,type;
@@ -80,7 +208,8 @@ int msg_recv_handle(int sockfd,char* buf)
 	{
 	    case ANDROID_OVER:
 		{
-		    android_send_task(ANDROID_TASK_OVER);
+		    spice_trace_dump();
+		    android_output_stop();
 		    g_main_loop_quit(android_mainloop);
 		    exit(1);
 		    return 1;
@@ -117,6 +246,26 @@ int msg_recv_handle(int sockfd,char* buf)
 		else
 		    error("msg_recv error!\n");
 		break;
+	    case ANDROID_TILE_STORE:
+		n = read(sockfd,buf,8);
+		if(n==4)
+		    n += read(sockfd,buf+4,4);
+		if(n==8)
+		{
+		    gint slot, gen;
+		    getval(&slot,buf,INT);
+		    getval(&gen,buf+4,INT);
+		    tile_ack_event(slot, gen);
+		}
+		else
+		    error("msg_recv error!\n");
+		break;
+	    case ANDROID_STATS:
+		stats_event();
+		break;
+	    case ANDROID_TRACE_DUMP:
+		spice_trace_dump();
+		break;
 	}
     }
     else
@@ -140,17 +289,20 @@ int write_data(int sockfd,uint8_t* buf,int size,int type)
     }
     return num;
 }
-int msg_send_handle(int sockfd)
+int msg_send_handle(int sockfd,AndroidShow* show)
 {
     int n;
-    uint8_t* buf = (uint8_t*)&(android_show_display.type);
+    uint8_t* buf = (uint8_t*)&(show->type);
     n = write_data(sockfd,buf,24,INT);
     if(n<=0)
 	goto error;
-    n = write(sockfd,android_show_display.data,android_show_display.size);
+    if(show->data == NULL)
+	return 0;
+    n = write(sockfd,show->data,show->size);
     if(n<=0)
 	goto error;
-    free(android_show_display.data);
+    free(show->data);
+    show->data = NULL;
     SPICE_DEBUG("Image bytes sent:%d",n);
     return 0;
 error:
@@ -161,18 +313,6 @@ error:
     return -1;
 }
 
-int raw2jpg(uint8_t* data, int width,int height )
-{
-    if(android_jpeg_encoder)
-	return jpeg_encode(android_jpeg_encoder,75,width,height,data,width*4,&android_show_display.data);
-    else
-    {
-	SPICE_DEBUG("no android_jpeg_encoder found!");
-	return 0;
-    }
-}
-
-
 /*
  * All the sins comes from the architect of Android: All UI must be
  * written in Java(at least <2.3), so I have to send the image buffer data to Java
@@ -180,26 +320,102 @@ int raw2jpg(uint8_t* data, int width,int height )
  * FIXME:This maybe the only rational way,but that means androidSpice will never leave
  * the status quo labelled EXPERIMENTAL.Tragic...
  *
- * FIXME: androidSpice UI in JAVA can only process the image of horizontal bars
- * So,even QXL gives me normal tiny rectangles,I should send bars to JAVA.
- * So I abandon some little rects to low the flow,this is stupid though...
+ * Only the damaged rectangle is encoded: Java keeps the whole desktop in
+ * a persistent bitmap and composites every update at (x,y).
+ * Large rectangles are cut into horizontal stripes, one per encoder, that
+ * Java composites just the same.
  */
+int android_show_stripes(gint w,gint h)
+{
+    return CLAMP(h / ANDROID_MIN_STRIPE_HEIGHT, 1, android_encoders_count);
+}
+
+/* the caller checks android_show_free() against android_show_stripes() first */
 void android_show(spice_display* d,gint x,gint y,gint w,gint h)
 {
-    android_show_display.type = ANDROID_SHOW;
-    android_show_display.width = d->width; //w;
-    android_show_display.height =  h;
-    android_show_display.x = 0;//x;
-    android_show_display.y = y;
-    android_show_display.size =  raw2jpg((uint8_t*)d->data+y*d->width*4,d->width,h);
-    SPICE_DEBUG("ANDROID_SHOW for %p:w--%d:h--%d:x--%d:y--%d:jpeg_size--%d",
-	    (char*)android_show_display.data,
-	    android_show_display.width,
-	    android_show_display.height,
-	    android_show_display.x,
-	    android_show_display.y,
-	    android_show_display.size);
-    android_send_task(ANDROID_TASK_SHOW);
+    AndroidShowJob* job;
+    uint8_t* src;
+    int i, j, n, top, rows;
+
+    n = android_show_stripes(w, h);
+    for (i = 0, top = y; i < n; i++, top += rows) {
+	rows = (y + h - top) / (n - i);
+	job = android_show_slot();
+	job->show.type = ANDROID_SHOW;
+	job->show.width = w;
+	job->show.height = rows;
+	job->show.x = x;
+	job->show.y = top;
+	job->show.data = NULL;
+	job->pixels = spice_malloc(w * rows * 4);
+	src = (uint8_t*)d->data + top * d->stride + x * 4;
+	for (j = 0; j < rows; j++, src += d->stride)
+	    memcpy(job->pixels + j * w * 4, src, w * 4);
+	job->ready = 0;
+	android_show_push();
+    }
+}
+
+/*
+ * Shared framebuffer mode: Java maps the primary surface itself, so only
+ * the surface geometry (ANDROID_SHM_CREATE) and the damaged rectangles
+ * (ANDROID_SHM_SHOW) are sent, without any encoding.
+ */
+void android_show_shared(AndroidEventType type,gint x,gint y,gint w,gint h)
+{
+    AndroidShowJob* job = android_show_slot();
+
+    job->show.type = type;
+    job->show.width = w;
+    job->show.height = h;
+    job->show.x = x;
+    job->show.y = y;
+    job->show.size = ++android_show_seq;
+    job->show.data = NULL;
+    job->pixels = NULL;
+    job->ready = 0;
+    android_show_push();
+}
+/* the tile messages need no encoding either, their payload is ready */
+void android_show_tiles(AndroidEventType type,gint gen,gint* triples,gint n)
+{
+    AndroidShowJob* job = android_show_slot();
+    uint8_t* buf;
+    int i;
+
+    job->show.type = type;
+    job->show.width = ANDROID_TILE_SIZE;
+    job->show.height = ANDROID_TILE_SIZE;
+    job->show.x = gen;
+    job->show.y = 0;
+    job->show.size = n * 3 * 4;
+    job->show.data = buf = spice_malloc(job->show.size);
+    for (i = 0; i < n * 3; i++, buf += 4) {
+	buf[0] = triples[i] >> 24;
+	buf[1] = triples[i] >> 16;
+	buf[2] = triples[i] >> 8;
+	buf[3] = triples[i];
+    }
+    job->pixels = NULL;
+    job->ready = 0;
+    android_show_push();
+}
+/* the JSON needs no encoding either */
+void android_show_stats(const gchar* json)
+{
+    AndroidShowJob* job = android_show_slot();
+
+    job->show.type = ANDROID_STATS;
+    job->show.width = 0;
+    job->show.height = 0;
+    job->show.x = 0;
+    job->show.y = 0;
+    job->show.size = strlen(json);
+    job->show.data = spice_malloc(job->show.size);
+    memcpy(job->show.data, json, job->show.size);
+    job->pixels = NULL;
+    job->ready = 0;
+    android_show_push();
 }
 int android_spice_input()
 {
@@ -241,6 +457,7 @@ int android_spice_output()
     socklen_t clilen;
     struct sockaddr_un  cli_addr, serv_addr;
 
+    android_encoders_start();
     if ((sockfd = socket(AF_UNIX,SOCK_STREAM,0)) < 0)
 	error("creating socket");
     memset((char *) &serv_addr,0, sizeof(serv_addr));
@@ -258,25 +475,14 @@ int android_spice_output()
     newsockfd = accept( sockfd,(struct sockaddr *)&cli_addr,&clilen);
     if (newsockfd < 0) 
 	error("accepting");
-    int over = 0;  
-    while(!over)  
-    {  
-	pthread_mutex_lock(&android_mutex);  
-	android_task_ready = 1;  
-	pthread_cond_wait(&android_cond,&android_mutex);  
-	SPICE_DEBUG("got task:%d\n",android_task);
-	if(android_task == ANDROID_TASK_SHOW) {
-	    if(msg_send_handle(newsockfd)) {
-		over = 1;
-	    }
-	    android_task = ANDROID_TASK_IDLE;  
-	} else if(android_task == ANDROID_TASK_OVER) {
-	    over =1;
-	    android_task = ANDROID_TASK_IDLE;  
-	}
-	pthread_mutex_unlock(&android_mutex);  
-	SPICE_DEBUG("got task done:%d\n",android_task);
-    }  
+    AndroidShow* show;
+    while((show = android_show_pop()) != NULL)
+    {
+	if(msg_send_handle(newsockfd,show))
+	    break;
+	android_show_release();
+    }
+    android_encoders_stop();
 
     close(newsockfd);
     close(sockfd);
@@ -179,6 +179,11 @@ typedef struct CanvasBase {
 
     void *usr_data;
     spice_destroy_fn_t usr_data_destroy;
+
+    /* decoded ahead, see spice_canvas_set_decoded_image() */
+    SpiceImage *decoded_image;
+    int decoded_want_original;
+    pixman_image_t *decoded_surface;
 } CanvasBase;
 
 typedef enum {
@@ -1100,8 +1105,14 @@ static pixman_image_t *canvas_get_image_internal(CanvasBase *canvas, SpiceImage
         want_original = TRUE;
     }
 
-    SPICE_DEBUG("-----------Got SPICE_IMAGE_TYPE:%d",descriptor->type);
-    switch (descriptor->type) {
+    SPICE_TRACE(CANVAS_IMAGE, descriptor->type, descriptor->flags,
+                descriptor->width, descriptor->height);
+    if (image == canvas->decoded_image &&
+        saved_want_original == canvas->decoded_want_original) {
+        surface = canvas->decoded_surface;
+        canvas->decoded_image = NULL;
+        canvas->decoded_surface = NULL;
+    } else switch (descriptor->type) {
     case SPICE_IMAGE_TYPE_QUIC: {
         surface = canvas_get_quic(canvas, image, 0, want_original);
         break;
@@ -1318,6 +1329,93 @@ static pixman_image_t* canvas_get_image_from_self(SpiceCanvas *canvas,
     return surface;
 }
 
+/*
+ * An uncached quic or jpeg image copied as is over a rectangle of the
+ * canvas is decoded right into the canvas memory, instead of into a
+ * temporary surface then blitted. Returns FALSE, having written nothing,
+ * if the image doesn't qualify: lz images are decoded packed, and only
+ * xRGB images go into an xRGB canvas without conversion.
+ */
+static int canvas_decode_in_place(CanvasBase *canvas, SpiceImage *image,
+                                  int x, int y)
+{
+    SpiceImageDescriptor *descriptor = &image->descriptor;
+    QuicData *quic_data = &canvas->quic_data;
+    pixman_image_t *dest_image = NULL;
+    QuicImageType type;
+    uint8_t *dest;
+    int stride;
+    int width;
+    int height;
+
+    if (descriptor->flags & (SPICE_IMAGE_FLAGS_CACHE_ME
+#ifdef SW_CANVAS_CACHE
+                             | SPICE_IMAGE_FLAGS_CACHE_REPLACE_ME
+#endif
+                            ) ||
+        canvas->format != SPICE_SURFACE_FMT_32_xRGB ||
+        canvas->parent.ops->get_image == NULL ||
+        image == canvas->decoded_image) {
+        return FALSE;
+    }
+
+    switch (descriptor->type) {
+    case SPICE_IMAGE_TYPE_QUIC:
+        if (setjmp(quic_data->jmp_env)) {
+            if (dest_image) {
+                pixman_image_unref(dest_image);
+            }
+            CANVAS_ERROR("quic error, %s", quic_data->message_buf);
+        }
+
+        quic_data->chunks = image->u.quic.data;
+        quic_data->current_chunk = 0;
+        if (quic_decode_begin(quic_data->quic,
+                              (uint32_t *)image->u.quic.data->chunk[0].data,
+                              image->u.quic.data->chunk[0].len >> 2,
+                              &type, &width, &height) == QUIC_ERROR) {
+            CANVAS_ERROR("quic decode begin failed");
+        }
+        if (type != QUIC_IMAGE_TYPE_RGB32 && type != QUIC_IMAGE_TYPE_RGB24) {
+            return FALSE;
+        }
+        break;
+    case SPICE_IMAGE_TYPE_JPEG:
+        ASSERT(image->u.jpeg.data->num_chunks == 1); /* TODO: Handle chunks */
+        canvas->jpeg->ops->begin_decode(canvas->jpeg, image->u.jpeg.data->chunk[0].data,
+                                        image->u.jpeg.data->chunk[0].len,
+                                        &width, &height);
+        break;
+    default:
+        return FALSE;
+    }
+
+    ASSERT((uint32_t)width == descriptor->width);
+    ASSERT((uint32_t)height == descriptor->height);
+
+    dest_image = canvas->parent.ops->get_image(&canvas->parent);
+    stride = pixman_image_get_stride(dest_image);
+    dest = (uint8_t *)pixman_image_get_data(dest_image) + y * stride + x * 4;
+
+    if (descriptor->type == SPICE_IMAGE_TYPE_QUIC) {
+        if (quic_decode(quic_data->quic, QUIC_IMAGE_TYPE_RGB32,
+                        dest, stride) == QUIC_ERROR) {
+            pixman_image_unref(dest_image);
+            CANVAS_ERROR("quic decode failed");
+        }
+    } else {
+        canvas->jpeg->ops->decode(canvas->jpeg, dest, stride, SPICE_BITMAP_FMT_32BIT);
+    }
+
+    if (descriptor->flags & SPICE_IMAGE_FLAGS_HIGH_BITS_SET) {
+        spice_pixman_fill_rect_rop(dest_image, x, y, width, height,
+                                   0xff000000U, SPICE_ROP_OR);
+    }
+
+    pixman_image_unref(dest_image);
+    return TRUE;
+}
+
 static inline uint8_t revers_bits(uint8_t byte)
 {
     uint8_t ret = 0;
@@ -1854,6 +1952,9 @@ static int quic_usr_more_lines(QuicUsrContext *usr, uint8_t **lines)
 
 static void canvas_base_destroy(CanvasBase *canvas)
 {
+    if (canvas->decoded_surface) {
+        pixman_image_unref(canvas->decoded_surface);
+    }
     quic_destroy(canvas->quic_data.quic);
     lz_destroy(canvas->lz_data.lz);
 #ifdef GDI_CANVAS
@@ -1888,6 +1989,90 @@ void *spice_canvas_get_usr_data(SpiceCanvas *spice_canvas)
     CanvasBase *canvas = (CanvasBase *)spice_canvas;
     return  canvas->usr_data;
 }
+
+void spice_canvas_set_decoded_image(SpiceCanvas *spice_canvas, SpiceImage *image,
+                                    int want_original, pixman_image_t *surface)
+{
+    CanvasBase *canvas = (CanvasBase *)spice_canvas;
+
+    if (canvas->decoded_surface) {
+        pixman_image_unref(canvas->decoded_surface);
+    }
+    canvas->decoded_image = image;
+    canvas->decoded_want_original = want_original;
+    canvas->decoded_surface = surface;
+}
+
+struct SpiceImageDecoder {
+    CanvasBase base; /* only the decoders and format are set */
+};
+
+SpiceImageDecoder *spice_image_decoder_new(SpiceJpegDecoder *jpeg_decoder)
+{
+    SpiceImageDecoder *decoder;
+    QuicData *quic_data;
+
+    decoder = spice_new0(SpiceImageDecoder, 1);
+    quic_data = &decoder->base.quic_data;
+    quic_data->usr.error = quic_usr_error;
+    quic_data->usr.warn = quic_usr_warn;
+    quic_data->usr.info = quic_usr_warn;
+    quic_data->usr.malloc = quic_usr_malloc;
+    quic_data->usr.free = quic_usr_free;
+    quic_data->usr.more_space = quic_usr_more_space;
+    quic_data->usr.more_lines = quic_usr_more_lines;
+    if (!(quic_data->quic = quic_create(&quic_data->usr))) {
+        free(decoder);
+        return NULL;
+    }
+    decoder->base.jpeg = jpeg_decoder;
+
+    return decoder;
+}
+
+void spice_image_decoder_destroy(SpiceImageDecoder *decoder)
+{
+    if (decoder == NULL) {
+        return;
+    }
+    quic_destroy(decoder->base.quic_data.quic);
+    free(decoder);
+}
+
+int spice_image_decoder_can_decode(SpiceImage *image)
+{
+    switch (image->descriptor.type) {
+    case SPICE_IMAGE_TYPE_QUIC:
+        return TRUE;
+    case SPICE_IMAGE_TYPE_JPEG:
+        return image->u.jpeg.data->num_chunks == 1;
+    default:
+        return FALSE;
+    }
+}
+
+pixman_image_t *spice_image_decoder_decode(SpiceImageDecoder *decoder, SpiceImage *image,
+                                           uint32_t format, int want_original)
+{
+    /* as canvas_get_image_internal() */
+    if (image->descriptor.flags & (SPICE_IMAGE_FLAGS_CACHE_ME
+#ifdef SW_CANVAS_CACHE
+                                   | SPICE_IMAGE_FLAGS_CACHE_REPLACE_ME
+#endif
+                                  )) {
+        want_original = TRUE;
+    }
+
+    decoder->base.format = format;
+    switch (image->descriptor.type) {
+    case SPICE_IMAGE_TYPE_QUIC:
+        return canvas_get_quic(&decoder->base, image, 0, want_original);
+    case SPICE_IMAGE_TYPE_JPEG:
+        return canvas_get_jpeg(&decoder->base, image, 0);
+    default:
+        CANVAS_ERROR("unexpected image type");
+    }
+}
 #endif
 
 
@@ -2195,6 +2380,21 @@ static void canvas_draw_copy(SpiceCanvas *spice_canvas, SpiceRect *bbox, SpiceCl
             }
         }
     } else {
+        if (rop == SPICE_ROP_COPY &&
+            copy->src_area.left == 0 && copy->src_area.top == 0 &&
+            copy->src_area.right == copy->src_bitmap->descriptor.width &&
+            copy->src_area.bottom == copy->src_bitmap->descriptor.height &&
+            rect_is_same_size(bbox, &copy->src_area) &&
+            pixman_region32_n_rects(&dest_region) == 1 &&
+            pixman_region32_extents(&dest_region)->x1 == bbox->left &&
+            pixman_region32_extents(&dest_region)->y1 == bbox->top &&
+            pixman_region32_extents(&dest_region)->x2 == bbox->right &&
+            pixman_region32_extents(&dest_region)->y2 == bbox->bottom &&
+            canvas_decode_in_place(canvas, copy->src_bitmap, bbox->left, bbox->top)) {
+            pixman_region32_fini(&dest_region);
+            return;
+        }
+
         src_image = canvas_get_image(canvas, copy->src_bitmap, FALSE);
         if (rect_is_same_size(bbox, &copy->src_area)) {
             if (rop == SPICE_ROP_COPY) {
@@ -3348,6 +3548,8 @@ static int canvas_base_init(CanvasBase *canvas, SpiceCanvasOps *ops,
                             , SpiceZlibDecoder *zlib_decoder
                             )
 {
+    surface_pool_init();
+
     canvas->parent.ops = ops;
     canvas->quic_data.usr.error = quic_usr_error;
     canvas->quic_data.usr.warn = quic_usr_warn;
@@ -309,6 +309,22 @@ typedef struct {
 void spice_canvas_set_usr_data(SpiceCanvas *canvas, void *data, spice_destroy_fn_t destroy_fn);
 void *spice_canvas_get_usr_data(SpiceCanvas *canvas);
 
+/* surface, decoded ahead by a SpiceImageDecoder with the same
+ * want_original, is used by the next draw of image instead of decoding
+ * it; the canvas takes the reference, pass NULLs to drop it */
+void spice_canvas_set_decoded_image(SpiceCanvas *canvas, SpiceImage *image,
+                                    int want_original, pixman_image_t *surface);
+
+/* decodes the images a canvas of the given format would, but each
+ * decoder can be used from its own thread */
+typedef struct SpiceImageDecoder SpiceImageDecoder;
+
+SpiceImageDecoder *spice_image_decoder_new(SpiceJpegDecoder *jpeg_decoder);
+void spice_image_decoder_destroy(SpiceImageDecoder *decoder);
+int spice_image_decoder_can_decode(SpiceImage *image);
+pixman_image_t *spice_image_decoder_decode(SpiceImageDecoder *decoder, SpiceImage *image,
+                                           uint32_t format, int want_original);
+
 struct _SpiceCanvas {
   SpiceCanvasOps *ops;
 };
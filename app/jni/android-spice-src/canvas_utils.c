@@ -24,7 +24,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #endif
+#include <stdint.h>
 #include "mem.h"
+#include "mutex.h"
 
 #ifdef WIN32
 static int gdi_handlers = 0;
@@ -45,6 +47,140 @@ static int gdi_handlers = 0;
 }
 #endif
 
+/*
+ * Pixel buffers of the decoded images, most of them released a moment
+ * after being drawn, are recycled instead of going back to malloc: they
+ * are kept in buckets of sizes 4k * 2^n * (1, 1.25, 1.5, 1.75), so that
+ * a buffer wastes at most a fifth of its size. Only the buffers between
+ * SURFACE_POOL_MIN and SURFACE_POOL_MAX bytes are pooled, up to
+ * SURFACE_POOL_IDLE bytes overall and SURFACE_POOL_DEPTH per bucket.
+ */
+#define SURFACE_POOL_MIN_SHIFT 12
+#define SURFACE_POOL_MAX_SHIFT 25
+#define SURFACE_POOL_MIN (1 << SURFACE_POOL_MIN_SHIFT)
+#define SURFACE_POOL_MAX (1 << SURFACE_POOL_MAX_SHIFT)
+#define SURFACE_POOL_BUCKETS ((SURFACE_POOL_MAX_SHIFT - SURFACE_POOL_MIN_SHIFT) * 4 + 1)
+#define SURFACE_POOL_DEPTH 4
+#define SURFACE_POOL_IDLE (24 * 1024 * 1024)
+
+typedef struct SurfacePoolBucket {
+    int count;
+    void *buffers[SURFACE_POOL_DEPTH];
+} SurfacePoolBucket;
+
+static struct {
+    mutex_t lock;
+    int initialized;
+    SurfacePoolBucket buckets[SURFACE_POOL_BUCKETS];
+    SurfacePoolStats stats;
+} surface_pool;
+
+void surface_pool_init(void)
+{
+    if (!surface_pool.initialized) {
+        MUTEX_INIT(surface_pool.lock);
+        surface_pool.initialized = 1;
+    }
+}
+
+/* returns the bucket of size, -1 if not pooled, and rounds size up */
+static int surface_pool_bucket(size_t *size)
+{
+    size_t n = *size - 1;
+    int shift;
+    int sub;
+
+    if (*size <= SURFACE_POOL_MIN) {
+        *size = SURFACE_POOL_MIN;
+        return 0;
+    }
+    if (*size > SURFACE_POOL_MAX) {
+        return -1;
+    }
+
+    /* 2^shift <= n < 2^(shift + 1) */
+    for (shift = SURFACE_POOL_MIN_SHIFT; (n >> (shift + 1)) != 0; shift++)
+        ;
+    sub = (n >> (shift - 2)) & 3;
+    *size = (size_t)(4 + sub + 1) << (shift - 2);
+    return (shift - SURFACE_POOL_MIN_SHIFT) * 4 + sub + 1;
+}
+
+static uint8_t *surface_pool_get(size_t *size)
+{
+    SurfacePoolBucket *bucket;
+    void *data = NULL;
+    int i;
+
+    surface_pool_init();
+    i = surface_pool_bucket(size);
+
+    MUTEX_LOCK(surface_pool.lock);
+    surface_pool.stats.requests++;
+    if (i >= 0) {
+        bucket = &surface_pool.buckets[i];
+        if (bucket->count > 0) {
+            data = bucket->buffers[--bucket->count];
+            surface_pool.stats.reuses++;
+            surface_pool.stats.idle_bytes -= *size;
+        }
+    } else {
+        surface_pool.stats.unpooled++;
+    }
+    MUTEX_UNLOCK(surface_pool.lock);
+
+    if (data == NULL) {
+        data = spice_malloc(*size);
+    }
+    return (uint8_t *)data;
+}
+
+static void surface_pool_put(uint8_t *data, size_t size)
+{
+    SurfacePoolBucket *bucket;
+    size_t bucket_size = size;
+    int i;
+
+    i = surface_pool_bucket(&bucket_size);
+    if (i >= 0 && bucket_size == size) {
+        MUTEX_LOCK(surface_pool.lock);
+        bucket = &surface_pool.buckets[i];
+        if (bucket->count < SURFACE_POOL_DEPTH &&
+            surface_pool.stats.idle_bytes + size <= SURFACE_POOL_IDLE) {
+            bucket->buffers[bucket->count++] = data;
+            surface_pool.stats.idle_bytes += size;
+            data = NULL;
+        }
+        MUTEX_UNLOCK(surface_pool.lock);
+    }
+    free(data);
+}
+
+void surface_pool_get_stats(SurfacePoolStats *stats)
+{
+    surface_pool_init();
+    MUTEX_LOCK(surface_pool.lock);
+    *stats = surface_pool.stats;
+    MUTEX_UNLOCK(surface_pool.lock);
+}
+
+void surface_pool_trim(void)
+{
+    SurfacePoolBucket *bucket;
+    int i;
+
+    surface_pool_init();
+    MUTEX_LOCK(surface_pool.lock);
+    for (i = 0; i < SURFACE_POOL_BUCKETS; i++) {
+        bucket = &surface_pool.buckets[i];
+        while (bucket->count > 0) {
+            free(bucket->buffers[--bucket->count]);
+        }
+    }
+    surface_pool.stats.idle_bytes = 0;
+    MUTEX_UNLOCK(surface_pool.lock);
+}
+
 static void release_data(pixman_image_t *image, void *release_data)
 {
     PixmanData *data = (PixmanData *)release_data;
@@ -57,7 +193,7 @@ static void release_data(pixman_image_t *image, void *release_data)
     }
 #endif
     if (data->data) {
-        free(data->data);
+        surface_pool_put(data->data, data->data_size);
     }
 
     free(data);
@@ -112,8 +248,13 @@ static inline pixman_image_t *__surface_create_stride(pixman_format_code_t forma
     uint8_t *stride_data;
     pixman_image_t *surface;
     PixmanData *pixman_data;
+    size_t size;
 
-    data = (uint8_t *)spice_malloc_n(abs(stride), height);
+    if (height > 0 && abs(stride) > SIZE_MAX / height) {
+        CANVAS_ERROR("surface too large");
+    }
+    size = (size_t)abs(stride) * height;
+    data = surface_pool_get(&size);
     if (stride < 0) {
         stride_data = data + (-stride) * (height - 1);
     } else {
@@ -123,12 +264,13 @@ static inline pixman_image_t *__surface_create_stride(pixman_format_code_t forma
     surface = pixman_image_create_bits(format, width, height, (uint32_t *)stride_data, stride);
 
     if (surface == NULL) {
-        free(data);
+        surface_pool_put(data, size);
         CANVAS_ERROR("create surface failed, out of memory");
     }
 
     pixman_data = pixman_image_add_data(surface);
     pixman_data->data = data;
+    pixman_data->data_size = size;
     pixman_data->format = format;
 
     return surface;
@@ -227,13 +369,10 @@ pixman_image_t * surface_create(pixman_format_code_t format, int width, int heig
     } else {
 #endif
     if (top_down) {
-        pixman_image_t *surface;
-        PixmanData *data;
+        /* the stride pixman would have picked, but a pooled buffer */
+        int stride = ((width * PIXMAN_FORMAT_BPP(format) + 0x1f) >> 5) * sizeof(uint32_t);
 
-        surface = pixman_image_create_bits(format, width, height, NULL, 0);
-        data = pixman_image_add_data(surface);
-        data->format = format;
-        return surface;
+        return __surface_create_stride(format, width, height, stride);
     } else {
         // NOTE: we assume here that the lz decoders always decode to RGB32.
         int stride = 0;
@@ -34,9 +34,23 @@ typedef struct PixmanData {
     HANDLE mutex;
 #endif
     uint8_t *data;
+    size_t data_size; /* of the pooled buffer at data */
     pixman_format_code_t format;
 } PixmanData;
 
+typedef struct SurfacePoolStats {
+    uint64_t requests;
+    uint64_t reuses;
+    uint64_t unpooled; /* too large for the pool */
+    size_t idle_bytes;
+} SurfacePoolStats;
+
+/* the pixel buffers of the surfaces below are recycled, thread safe once
+ * surface_pool_init() returned (it is called by the canvas constructors) */
+void surface_pool_init(void);
+void surface_pool_get_stats(SurfacePoolStats *stats);
+void surface_pool_trim(void);
+
 void spice_pixman_image_set_format(pixman_image_t *image,
                                    pixman_format_code_t format);
 pixman_format_code_t spice_pixman_image_get_format(pixman_image_t *image);
@@ -84,7 +84,10 @@ static void spice_cursor_channel_init(SpiceCursorChannel *channel)
 
 static void spice_cursor_channel_finalize(GObject *obj)
 {
+    spice_cursor_channel *c = SPICE_CURSOR_CHANNEL(obj)->priv;
+
     delete_cursor_all(SPICE_CHANNEL(obj));
+    cache_destroy(&c->cursors);
 
     if (G_OBJECT_CLASS(spice_cursor_channel_parent_class)->finalize)
         G_OBJECT_CLASS(spice_cursor_channel_parent_class)->finalize(obj);
@@ -468,6 +471,13 @@ static void cursor_handle_set(SpiceChannel *channel, spice_msg_in *in)
     emit_cursor_set(channel, cursor);
 }
 
+/* only the last position matters */
+static gboolean coalesce_move(int signum, gpointer queued, gconstpointer params)
+{
+    *(struct SPICE_CURSOR_MOVE *)queued = *(const struct SPICE_CURSOR_MOVE *)params;
+    return TRUE;
+}
+
 /* coroutine context */
 static void cursor_handle_move(SpiceChannel *channel, spice_msg_in *in)
 {
@@ -476,8 +486,8 @@ static void cursor_handle_move(SpiceChannel *channel, spice_msg_in *in)
 
     g_return_if_fail(c->init_done == TRUE);
 
-    emit_main_context(channel, SPICE_CURSOR_MOVE,
-                      move->position.x, move->position.y);
+    emit_main_context_async(channel, coalesce_move, NULL, SPICE_CURSOR_MOVE,
+                            move->position.x, move->position.y);
 }
 
 /* coroutine context */
@@ -32,6 +32,7 @@
 G_BEGIN_DECLS
 
 #define DISPLAY_PIXMAP_CACHE (1024 * 1024 * 32)
+#define DISPLAY_PIXMAP_CACHE_MIN (1024 * 1024 * 4)
 #define GLZ_WINDOW_SIZE      (1024 * 1024 * 16)
 
 typedef struct display_surface {
@@ -29,6 +29,10 @@
 #include <sys/ipc.h>
 #endif
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
 #include "spice-client.h"
 #include "spice-common.h"
 
@@ -63,6 +67,9 @@
 
 struct spice_display_channel {
     Ring                        surfaces;
+    display_surface             **surface_table; /* indexed by surface_id */
+    int                         surface_table_size;
+    display_surface             *last_surface;
     display_cache               images;
     display_cache               palettes;
     SpiceImageCache             image_cache;
@@ -72,6 +79,13 @@ struct spice_display_channel {
     display_stream              **streams;
     int                         nstreams;
     gboolean                    mark;
+
+    /* see decode_job_new() */
+    GThreadPool                 *decode_pool;
+    GQueue                      decode_pending;
+    GMutex                      *decode_lock;
+    GCond                       *decode_cond;
+    GSList                      *decoders;
 #ifdef WIN32
     HDC dc;
 #endif
@@ -91,6 +105,7 @@ enum {
 static guint signals[SPICE_DISPLAY_LAST_SIGNAL];
 
 static void spice_display_handle_msg(SpiceChannel *channel, spice_msg_in *msg);
+static void spice_display_read_idle(SpiceChannel *channel);
 static void spice_display_channel_init(SpiceDisplayChannel *channel);
 static void spice_display_channel_up(SpiceChannel *channel);
 
@@ -100,6 +115,18 @@ static void clear_surfaces(SpiceChannel *channel);
 static void clear_streams(SpiceChannel *channel);
 static display_surface *find_surface(spice_display_channel *c, int surface_id);
 static gboolean display_stream_render(display_stream *st);
+static void decode_pipeline_start(spice_display_channel *c);
+static void decode_pipeline_stop(spice_display_channel *c);
+
+/* draws looked at by draw_view_dropped() before being parsed */
+static const int lazy_draws[] = {
+    SPICE_MSG_DISPLAY_DRAW_OPAQUE,
+    SPICE_MSG_DISPLAY_DRAW_COPY,
+    SPICE_MSG_DISPLAY_DRAW_BLEND,
+    SPICE_MSG_DISPLAY_DRAW_TEXT,
+    SPICE_MSG_DISPLAY_DRAW_TRANSPARENT,
+    SPICE_MSG_DISPLAY_DRAW_ALPHA_BLEND,
+};
 
 /* ------------------------------------------------------------------ */
 
@@ -107,11 +134,16 @@ static void spice_display_channel_finalize(GObject *obj)
 {
     spice_display_channel *c = SPICE_DISPLAY_CHANNEL(obj)->priv;
 
+    decode_pipeline_stop(c);
     palette_clear(&c->palette_cache);
     image_clear(&c->image_cache);
+    cache_destroy(&c->palettes);
+    cache_destroy(&c->images);
     clear_surfaces(SPICE_CHANNEL(obj));
+    g_free(c->surface_table);
     clear_streams(SPICE_CHANNEL(obj));
     glz_decoder_window_destroy(c->glz_window);
+    surface_pool_trim();
 
     if (G_OBJECT_CLASS(spice_display_channel_parent_class)->finalize)
         G_OBJECT_CLASS(spice_display_channel_parent_class)->finalize(obj);
@@ -125,6 +157,7 @@ static void spice_display_channel_class_init(SpiceDisplayChannelClass *klass)
     gobject_class->finalize     = spice_display_channel_finalize;
     channel_class->handle_msg   = spice_display_handle_msg;
     channel_class->channel_up   = spice_display_channel_up;
+    channel_class->read_idle    = spice_display_read_idle;
 
     /**
      * SpiceDisplayChannel::display-primary-create:
@@ -281,13 +314,19 @@ static void do_emit_main_context(GObject *object, int signum, gpointer params)
 
 /* ------------------------------------------------------------------ */
 
+static size_t image_size(pixman_image_t *image)
+{
+    return (size_t)abs(pixman_image_get_stride(image)) *
+        pixman_image_get_height(image);
+}
+
 static void image_put(SpiceImageCache *cache, uint64_t id, pixman_image_t *image)
 {
     spice_display_channel *c =
         SPICE_CONTAINEROF(cache, spice_display_channel, image_cache);
     display_cache_item *item;
 
-    item = cache_find(&c->images, id);
+    item = cache_lookup(&c->images, id);
     if (item) {
         cache_ref(item);
         return;
@@ -295,6 +334,7 @@ static void image_put(SpiceImageCache *cache, uint64_t id, pixman_image_t *image
 
     item = cache_add(&c->images, id);
     item->ptr = pixman_image_ref(image);
+    cache_set_size(&c->images, item, image_size(image));
 }
 
 static pixman_image_t *image_get(SpiceImageCache *cache, uint64_t id)
@@ -304,6 +344,15 @@ static pixman_image_t *image_get(SpiceImageCache *cache, uint64_t id)
     display_cache_item *item;
 
     item = cache_find(&c->images, id);
+    if (((c->images.hits + c->images.misses) & 4095) == 0) {
+        SurfacePoolStats pool;
+
+        cache_log_stats(&c->images);
+        surface_pool_get_stats(&pool);
+        SPICE_DEBUG("surface pool: %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " reused, "
+                    "%" G_GUINT64_FORMAT " too large, %" G_GSIZE_FORMAT " bytes idle",
+                    pool.reuses, pool.requests, pool.unpooled, pool.idle_bytes);
+    }
     if (item) {
         cache_used(&c->images, item);
         return pixman_image_ref(item->ptr);
@@ -317,11 +366,12 @@ static void image_remove(SpiceImageCache *cache, uint64_t id)
         SPICE_CONTAINEROF(cache, spice_display_channel, image_cache);
     display_cache_item *item;
 
-    item = cache_find(&c->images, id);
+    item = cache_lookup(&c->images, id);
     g_return_if_fail(item != NULL);
     if (cache_unref(item)) {
         pixman_image_unref(item->ptr);
         cache_del(&c->images, item);
+        c->images.evictions++;
     }
 }
 
@@ -331,6 +381,7 @@ static void image_clear(SpiceImageCache *cache)
         SPICE_CONTAINEROF(cache, spice_display_channel, image_cache);
     display_cache_item *item;
 
+    cache_log_stats(&c->images);
     for (;;) {
         item = cache_get_lru(&c->images);
         if (item == NULL) {
@@ -347,9 +398,12 @@ static void palette_put(SpicePaletteCache *cache, SpicePalette *palette)
         SPICE_CONTAINEROF(cache, spice_display_channel, palette_cache);
     display_cache_item *item;
 
+    size_t size = sizeof(SpicePalette) +
+        palette->num_ents * sizeof(palette->ents[0]);
+
     item = cache_add(&c->palettes, palette->unique);
-    item->ptr = g_memdup(palette, sizeof(SpicePalette) +
-                         palette->num_ents * sizeof(palette->ents[0]));
+    item->ptr = g_memdup(palette, size);
+    cache_set_size(&c->palettes, item, size);
 }
 
 static SpicePalette *palette_get(SpicePaletteCache *cache, uint64_t id)
@@ -372,7 +426,7 @@ static void palette_remove(SpicePaletteCache *cache, uint32_t id)
         SPICE_CONTAINEROF(cache, spice_display_channel, palette_cache);
     display_cache_item *item;
 
-    item = cache_find(&c->palettes, id);
+    item = cache_lookup(&c->palettes, id);
     if (item) {
         if (cache_unref(item)) {
             g_free(item->ptr);
@@ -392,6 +446,7 @@ static void palette_clear(SpicePaletteCache *cache)
         if (item == NULL) {
             break;
         }
+        g_free(item->ptr);
         cache_del(&c->palettes, item);
     }
 }
@@ -410,12 +465,13 @@ static void image_put_lossy(SpiceImageCache *cache, uint64_t id,
     display_cache_item *item;
 
 #if 1 /* TODO: temporary sanity check */
-    g_warn_if_fail(cache_find(&c->images, id) == NULL);
+    g_warn_if_fail(cache_lookup(&c->images, id) == NULL);
 #endif
 
     item = cache_add(&c->images, id);
     item->ptr = pixman_image_ref(surface);
     item->lossy = TRUE;
+    cache_set_size(&c->images, item, image_size(surface));
 }
 
 static void image_replace_lossy(SpiceImageCache *cache, uint64_t id,
@@ -425,12 +481,13 @@ static void image_replace_lossy(SpiceImageCache *cache, uint64_t id,
         SPICE_CONTAINEROF(cache, spice_display_channel, image_cache);
     display_cache_item *item;
 
-    item = cache_find(&c->images, id);
+    item = cache_lookup(&c->images, id);
     g_return_if_fail(item != NULL);
 
     pixman_image_unref(item->ptr);
     item->ptr = pixman_image_ref(surface);
     item->lossy = FALSE;
+    cache_set_size(&c->images, item, image_size(surface));
 }
 
 static pixman_image_t* image_get_lossless(SpiceImageCache *cache, uint64_t id)
@@ -499,16 +556,21 @@ static HDC create_compatible_dc(void)
 static void spice_display_channel_init(SpiceDisplayChannel *channel)
 {
     spice_display_channel *c;
+    int i;
 
     c = channel->priv = SPICE_DISPLAY_CHANNEL_GET_PRIVATE(channel);
     memset(c, 0, sizeof(*c));
 
+    for (i = 0; i < SPICE_N_ELEMENTS(lazy_draws); i++)
+        spice_channel_set_lazy_parse(SPICE_CHANNEL(channel), lazy_draws[i]);
+
     ring_init(&c->surfaces);
     cache_init(&c->images, "image");
     cache_init(&c->palettes, "palette");
     c->image_cache.ops = &image_cache_ops;
     c->palette_cache.ops = &palette_cache_ops;
     c->image_surfaces.ops = &image_surfaces_ops;
+    decode_pipeline_start(c);
 #if defined(WIN32)
     c->dc = create_compatible_dc();
 #endif
@@ -516,6 +578,43 @@ static void spice_display_channel_init(SpiceDisplayChannel *channel)
 
 /* ------------------------------------------------------------------ */
 
+/*
+ * Map the primary surface from the file shared with the UI process, so
+ * that only damage notifications have to go through the output socket.
+ * The file is never shrunk: the UI may still be reading the old mapping.
+ */
+static void create_shared_framebuffer(SpiceChannel *channel, display_surface *surface)
+{
+    const gchar *path;
+    struct stat st;
+    int fd;
+
+    path = spice_session_get_shared_framebuffer(spice_channel_get_session(channel));
+    if (path == NULL)
+        return;
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        g_warning("open %s: %s", path, strerror(errno));
+        return;
+    }
+    if (fstat(fd, &st) < 0 ||
+        (st.st_size < surface->size && ftruncate(fd, surface->size) < 0)) {
+        g_warning("resize %s: %s", path, strerror(errno));
+        close(fd);
+        return;
+    }
+    surface->data = mmap(NULL, surface->size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+    if (surface->data == MAP_FAILED) {
+        g_warning("mmap %s: %s", path, strerror(errno));
+        surface->data = NULL;
+        close(fd);
+        return;
+    }
+    surface->shmid = fd;
+}
+
 static int create_canvas(SpiceChannel *channel, display_surface *surface)
 {
     spice_display_channel *c = SPICE_DISPLAY_CHANNEL(channel)->priv;
@@ -535,6 +634,8 @@ static int create_canvas(SpiceChannel *channel, display_surface *surface)
 #else
 */
         surface->shmid = -1;
+        if (surface->format == SPICE_SURFACE_FMT_32_xRGB)
+            create_shared_framebuffer(channel, surface);
 //#endif
     } else {
         surface->shmid = -1;
@@ -586,6 +687,9 @@ static void destroy_canvas(display_surface *surface)
 
     if (surface->shmid == -1) {
         free(surface->data);
+    } else {
+        munmap(surface->data, surface->size);
+        close(surface->shmid);
     }
     /*
 #ifdef HAVE_SYS_SHM_H
@@ -601,19 +705,74 @@ shmdt(surface->data);
     surface->canvas = NULL;
 }
 
+/*
+ * Every draw looks its surface up: the ids, allocated by the guest from
+ * 0, index a table, and runs of draws on the same surface only compare
+ * the last one. The ring is only walked to clear all the surfaces, or
+ * to find ids too large for the table.
+ */
+#define SURFACE_TABLE_MAX 65536
+
 static display_surface *find_surface(spice_display_channel *c, int surface_id)
 {
     display_surface *surface;
     RingItem *item;
 
-    for (item = ring_get_head(&c->surfaces);
-         item != NULL;
-         item = ring_next(&c->surfaces, item)) {
-        surface = SPICE_CONTAINEROF(item, display_surface, link);
-        if (surface->surface_id == surface_id)
-            return surface;
+    surface = c->last_surface;
+    if (surface != NULL && surface->surface_id == surface_id)
+        return surface;
+
+    if (surface_id >= 0 && surface_id < c->surface_table_size) {
+        surface = c->surface_table[surface_id];
+    } else if (surface_id < 0 || surface_id >= SURFACE_TABLE_MAX) {
+        surface = NULL;
+        for (item = ring_get_head(&c->surfaces);
+             item != NULL;
+             item = ring_next(&c->surfaces, item)) {
+            surface = SPICE_CONTAINEROF(item, display_surface, link);
+            if (surface->surface_id == surface_id)
+                break;
+            surface = NULL;
+        }
+    } else {
+        surface = NULL;
     }
-    return NULL;
+
+    if (surface != NULL)
+        c->last_surface = surface;
+    return surface;
+}
+
+static void add_surface(spice_display_channel *c, display_surface *surface)
+{
+    int id = surface->surface_id;
+    int size;
+
+    ring_add(&c->surfaces, &surface->link);
+    if (id < 0 || id >= SURFACE_TABLE_MAX)
+        return;
+
+    if (id >= c->surface_table_size) {
+        for (size = MAX(c->surface_table_size, 16); size <= id; size *= 2)
+            ;
+        c->surface_table = g_renew(display_surface *, c->surface_table, size);
+        memset(c->surface_table + c->surface_table_size, 0,
+               (size - c->surface_table_size) * sizeof(display_surface *));
+        c->surface_table_size = size;
+    }
+    c->surface_table[id] = surface;
+}
+
+/* doesn't free it */
+static void remove_surface(spice_display_channel *c, display_surface *surface)
+{
+    int id = surface->surface_id;
+
+    ring_remove(&surface->link);
+    if (id >= 0 && id < c->surface_table_size && c->surface_table[id] == surface)
+        c->surface_table[id] = NULL;
+    if (c->last_surface == surface)
+        c->last_surface = NULL;
 }
 
 static void clear_surfaces(SpiceChannel *channel)
@@ -625,12 +784,42 @@ static void clear_surfaces(SpiceChannel *channel)
     while (!ring_is_empty(&c->surfaces)) {
         item = ring_get_head(&c->surfaces);
         surface = SPICE_CONTAINEROF(item, display_surface, link);
-        ring_remove(&surface->link);
+        remove_surface(c, surface);
         destroy_canvas(surface);
         free(surface);
     }
 }
 
+/* merges rectangles whose union is still a rectangle, as when a burst
+ * of draws sweeps an area line by line */
+static gboolean coalesce_invalidate(int signum, gpointer queued, gconstpointer params)
+{
+    struct SPICE_DISPLAY_INVALIDATE *q = queued;
+    const struct SPICE_DISPLAY_INVALIDATE *p = params;
+
+    if (p->x >= q->x && p->y >= q->y &&
+        p->x + p->w <= q->x + q->w && p->y + p->h <= q->y + q->h)
+        return TRUE;
+    if (q->x >= p->x && q->y >= p->y &&
+        q->x + q->w <= p->x + p->w && q->y + q->h <= p->y + p->h) {
+        *q = *p;
+        return TRUE;
+    }
+    if (p->x == q->x && p->w == q->w &&
+        (p->y == q->y + q->h || p->y + p->h == q->y)) {
+        q->y = MIN(p->y, q->y);
+        q->h += p->h;
+        return TRUE;
+    }
+    if (p->y == q->y && p->h == q->h &&
+        (p->x == q->x + q->w || p->x + p->w == q->x)) {
+        q->x = MIN(p->x, q->x);
+        q->w += p->w;
+        return TRUE;
+    }
+    return FALSE;
+}
+
 /* coroutine context */
 static void emit_invalidate(SpiceChannel *channel, SpiceRect *bbox)
 {
@@ -643,25 +832,47 @@ static void emit_invalidate(SpiceChannel *channel, SpiceRect *bbox)
         emit_main_context(channel, SPICE_DISPLAY_MARK, TRUE);
     }
 
-    emit_main_context(channel, SPICE_DISPLAY_INVALIDATE,
-                      bbox->left, bbox->top,
-                      bbox->right - bbox->left,
-                      bbox->bottom - bbox->top);
+    emit_main_context_async(channel, coalesce_invalidate, NULL,
+                            SPICE_DISPLAY_INVALIDATE,
+                            bbox->left, bbox->top,
+                            bbox->right - bbox->left,
+                            bbox->bottom - bbox->top);
 }
 
 /* ------------------------------------------------------------------ */
 
+/* the "cache-size" of the session, or a 16th of the device memory */
+static size_t display_cache_budget(SpiceChannel *channel)
+{
+    gint size = spice_session_get_cache_size(spice_channel_get_session(channel));
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    if (size > 0)
+        return size;
+    if (pages <= 0 || page_size <= 0)
+        return DISPLAY_PIXMAP_CACHE;
+    return CLAMP((guint64)pages * page_size / 16,
+                 DISPLAY_PIXMAP_CACHE_MIN, DISPLAY_PIXMAP_CACHE);
+}
+
 /* coroutine context */
 static void spice_display_channel_up(SpiceChannel *channel)
 {
+    spice_display_channel *c = SPICE_DISPLAY_CHANNEL(channel)->priv;
     spice_msg_out *out;
     SpiceMsgcDisplayInit init = {
         .pixmap_cache_id            = 1,
-        .pixmap_cache_size          = DISPLAY_PIXMAP_CACHE,
         .glz_dictionary_id          = 1,
         .glz_dictionary_window_size = GLZ_WINDOW_SIZE,
     };
 
+    c->images.budget = display_cache_budget(channel);
+    /* the server keeps its pixmap cache within this size, accounting
+       width * height per image: our images take 4 bytes a pixel */
+    init.pixmap_cache_size = c->images.budget / 4;
+    SPICE_DEBUG("pixmap cache budget: %" G_GSIZE_FORMAT " bytes", c->images.budget);
+
     out = spice_msg_out_new(channel, SPICE_MSGC_DISPLAY_INIT);
     out->marshallers->msgc_display_init(out->marshaller, &init);
     spice_msg_out_send_internal(out);
@@ -669,9 +880,11 @@ static void spice_display_channel_up(SpiceChannel *channel)
 }
 
 #define DRAW(type) {                                                    \
-        display_surface *surface =                                      \
-            find_surface(SPICE_DISPLAY_CHANNEL(channel)->priv,          \
-                op->base.surface_id);                                   \
+        display_surface *surface;                                       \
+        if (op == NULL) /* malformed, see spice_msg_in_parsed() */      \
+            return;                                                     \
+        surface = find_surface(SPICE_DISPLAY_CHANNEL(channel)->priv,    \
+                               op->base.surface_id);                    \
         g_return_if_fail(surface != NULL);                              \
         surface->canvas->ops->draw_##type(surface->canvas, &op->base.box, \
                                           &op->base.clip, &op->data);   \
@@ -691,7 +904,7 @@ static void display_handle_mode(SpiceChannel *channel, spice_msg_in *in)
 
     if (surface) {
         emit_main_context(channel, SPICE_DISPLAY_PRIMARY_DESTROY);
-        ring_remove(&surface->link);
+        remove_surface(c, surface);
         destroy_canvas(surface);
         free(surface);
     }
@@ -715,7 +928,7 @@ static void display_handle_mode(SpiceChannel *channel, spice_msg_in *in)
     }
 #endif
 */
-    ring_add(&c->surfaces, &surface->link);
+    add_surface(c, surface);
 }
 
 /* coroutine context */
@@ -776,6 +989,7 @@ static void display_handle_inv_list(SpiceChannel *channel, spice_msg_in *in)
     for (i = 0; i < list->count; i++) {
         switch (list->resources[i].type) {
         case SPICE_RES_TYPE_PIXMAP:
+            c->images.invalidations++;
             image_remove(&c->image_cache, list->resources[i].id);
             break;
         default:
@@ -790,6 +1004,7 @@ static void display_handle_inv_pixmap_all(SpiceChannel *channel, spice_msg_in *i
 {
     spice_display_channel *c = SPICE_DISPLAY_CHANNEL(channel)->priv;
 
+    c->images.invalidations += c->images.nitems;
     image_clear(&c->image_cache);
 }
 
@@ -1174,7 +1389,7 @@ static void display_handle_surface_create(SpiceChannel *channel, spice_msg_in *i
     SPICE_DEBUG("%s:%s:%d:%p\n\t%d:%d\n",__FILE__, __FUNCTION__,
 	    __LINE__,(char*)surface->data,surface->width,surface->height);
 
-    ring_add(&c->surfaces, &surface->link);
+    add_surface(c, surface);
 }
 
 /* coroutine context */
@@ -1196,7 +1411,7 @@ static void display_handle_surface_destroy(SpiceChannel *channel, spice_msg_in *
         emit_main_context(channel, SPICE_DISPLAY_PRIMARY_DESTROY);
     }
 
-    ring_remove(&surface->link);
+    remove_surface(c, surface);
     destroy_canvas(surface);
     free(surface);
 }
@@ -1241,12 +1456,534 @@ static spice_msg_handler display_handlers[] = {
     [ SPICE_MSG_DISPLAY_SURFACE_DESTROY ]    = display_handle_surface_destroy,
 };
 
+/* ------------------------------------------------------------------ */
+
+/*
+ * The quic and jpeg images of the draws read ahead are decoded by a pool
+ * of threads while the coroutine goes on reading messages. The draws are
+ * held back and run in order before any other message is handled, and
+ * before the coroutine waits for more data (see spice_display_read_idle),
+ * so that the caches, the glz window and the surfaces see the exact same
+ * sequence as without the pipeline.
+ *
+ * A single quic image can't be split between threads: its models are
+ * updated by the three channels in turn in one bitstream, and whether a
+ * run comes next depends on the pixels decoded so far in the current and
+ * previous rows. Large images don't fit in the receive buffer, so images
+ * are kept in flight as long as data comes in, not only while whole
+ * messages are buffered, to get several of them decoded at once during
+ * full screen updates.
+ *
+ * Plain copies of a whole uncached image are left out of the pipeline:
+ * canvas_decode_in_place() writes them straight into the surface, which
+ * saves a temporary surface and a blit per image, more than what running
+ * their decode ahead would gain.
+ */
+#define DECODE_THREADS_MAX 4
+#define DECODE_PENDING_MAX 16
+
+typedef enum {
+    DECODE_QUEUED,
+    DECODE_RUNNING,
+    DECODE_DONE,
+} decode_state;
+
+typedef struct decode_job {
+    int                 refs; /* the pending queue and the pool */
+    decode_state        state;
+    spice_msg_in        *in;
+    int                 surface_id;
+    uint32_t            format;
+    SpiceImage          *image;
+    int                 want_original;
+    pixman_image_t      *surface;
+} decode_job;
+
+typedef struct decode_worker {
+    SpiceImageDecoder   *decoder;
+    SpiceJpegDecoder    *jpeg_decoder;
+} decode_worker;
+
+/* takes c->decode_lock */
+static void decode_job_unref(spice_display_channel *c, decode_job *job)
+{
+    int refs;
+
+    g_mutex_lock(c->decode_lock);
+    refs = --job->refs;
+    g_mutex_unlock(c->decode_lock);
+    if (refs > 0)
+        return;
+
+    if (job->surface)
+        pixman_image_unref(job->surface);
+    g_free(job);
+}
+
+/* any thread, without c->decode_lock */
+static void decode_job_decode(spice_display_channel *c, decode_job *job)
+{
+    decode_worker *worker = NULL;
+
+    g_mutex_lock(c->decode_lock);
+    if (c->decoders) {
+        worker = c->decoders->data;
+        c->decoders = g_slist_delete_link(c->decoders, c->decoders);
+    }
+    g_mutex_unlock(c->decode_lock);
+
+    if (worker == NULL) {
+        worker = g_new0(decode_worker, 1);
+        worker->jpeg_decoder = jpeg_decoder_new();
+        worker->decoder = spice_image_decoder_new(worker->jpeg_decoder);
+    }
+
+    job->surface = spice_image_decoder_decode(worker->decoder, job->image,
+                                              job->format, job->want_original);
+
+    g_mutex_lock(c->decode_lock);
+    c->decoders = g_slist_prepend(c->decoders, worker);
+    job->state = DECODE_DONE;
+    g_cond_broadcast(c->decode_cond);
+    g_mutex_unlock(c->decode_lock);
+}
+
+/* pool thread */
+static void decode_job_run(gpointer data, gpointer user_data)
+{
+    spice_display_channel *c = user_data;
+    decode_job *job = data;
+    gboolean queued;
+
+    g_mutex_lock(c->decode_lock);
+    queued = job->state == DECODE_QUEUED;
+    if (queued)
+        job->state = DECODE_RUNNING;
+    g_mutex_unlock(c->decode_lock);
+
+    /* else the coroutine got to it first */
+    if (queued)
+        decode_job_decode(c, job);
+    decode_job_unref(c, job);
+}
+
+/* coroutine context */
+static void decode_run_next(SpiceChannel *channel)
+{
+    spice_display_channel *c = SPICE_DISPLAY_CHANNEL(channel)->priv;
+    decode_job *job = g_queue_pop_head(&c->decode_pending);
+    display_surface *surface;
+    int type = spice_msg_in_type(job->in);
+    guint64 start = spice_channel_now_ns();
+
+    g_mutex_lock(c->decode_lock);
+    if (job->state == DECODE_QUEUED) {
+        /* rather than waiting for a thread to pick it up */
+        job->state = DECODE_RUNNING;
+        g_mutex_unlock(c->decode_lock);
+        decode_job_decode(c, job);
+        g_mutex_lock(c->decode_lock);
+    }
+    /* only blocks while a thread is busy with this very image */
+    while (job->state != DECODE_DONE)
+        g_cond_wait(c->decode_cond, c->decode_lock);
+    g_mutex_unlock(c->decode_lock);
+
+    surface = find_surface(c, job->surface_id);
+    if (surface) {
+        spice_canvas_set_decoded_image(surface->canvas, job->image,
+                                       job->want_original, job->surface);
+        job->surface = NULL;
+    }
+    display_handlers[type](channel, job->in);
+    if (surface)
+        spice_canvas_set_decoded_image(surface->canvas, NULL, FALSE, NULL);
+    spice_channel_msg_stats_add_deferred(channel, job->in, spice_channel_now_ns() - start);
+
+    spice_msg_in_unref(job->in);
+    decode_job_unref(c, job);
+}
+
+/* coroutine context */
+static void decode_flush(SpiceChannel *channel)
+{
+    spice_display_channel *c = SPICE_DISPLAY_CHANNEL(channel)->priv;
+
+    while (!g_queue_is_empty(&c->decode_pending))
+        decode_run_next(channel);
+}
+
+/* what canvas_decode_in_place() will take, assuming the clip holds */
+static gboolean decode_in_place(SpiceMsgDisplayDrawCopy *op, display_surface *surface)
+{
+    SpiceImage *image = op->data.src_bitmap;
+    SpiceRect *src = &op->data.src_area;
+    SpiceRect *box = &op->base.box;
+
+    return surface->format == SPICE_SURFACE_FMT_32_xRGB &&
+        op->base.clip.type == SPICE_CLIP_TYPE_NONE &&
+        op->data.rop_descriptor == SPICE_ROPD_OP_PUT &&
+        op->data.mask.bitmap == NULL &&
+        !(image->descriptor.flags & (SPICE_IMAGE_FLAGS_CACHE_ME |
+                                     SPICE_IMAGE_FLAGS_CACHE_REPLACE_ME)) &&
+        src->left == 0 && src->top == 0 &&
+        src->right == image->descriptor.width &&
+        src->bottom == image->descriptor.height &&
+        box->right - box->left == src->right &&
+        box->bottom - box->top == src->bottom;
+}
+
+/* coroutine context, returns whether in is queued */
+static gboolean decode_job_new(SpiceChannel *channel, spice_msg_in *in)
+{
+    spice_display_channel *c = SPICE_DISPLAY_CHANNEL(channel)->priv;
+    SpiceMsgDisplayBase *base;
+    SpiceImage *image;
+    display_surface *surface;
+    int want_original = FALSE;
+    decode_job *job;
+
+    if (c->decode_pool == NULL)
+        return FALSE;
+    /* malformed, dropped by its handler */
+    if (spice_msg_in_parsed(in) == NULL)
+        return FALSE;
+
+    /* the images got with canvas_get_image() by the draws */
+    switch (spice_msg_in_type(in)) {
+    case SPICE_MSG_DISPLAY_DRAW_COPY: {
+        SpiceMsgDisplayDrawCopy *op = spice_msg_in_parsed(in);
+        base = &op->base;
+        image = op->data.src_bitmap;
+        break;
+    }
+    case SPICE_MSG_DISPLAY_DRAW_BLEND: {
+        SpiceMsgDisplayDrawBlend *op = spice_msg_in_parsed(in);
+        base = &op->base;
+        image = op->data.src_bitmap;
+        break;
+    }
+    case SPICE_MSG_DISPLAY_DRAW_OPAQUE: {
+        SpiceMsgDisplayDrawOpaque *op = spice_msg_in_parsed(in);
+        base = &op->base;
+        image = op->data.src_bitmap;
+        break;
+    }
+    case SPICE_MSG_DISPLAY_DRAW_TRANSPARENT: {
+        SpiceMsgDisplayDrawTransparent *op = spice_msg_in_parsed(in);
+        base = &op->base;
+        image = op->data.src_bitmap;
+        break;
+    }
+    case SPICE_MSG_DISPLAY_DRAW_ALPHA_BLEND: {
+        SpiceMsgDisplayDrawAlphaBlend *op = spice_msg_in_parsed(in);
+        base = &op->base;
+        image = op->data.src_bitmap;
+        want_original = TRUE;
+        break;
+    }
+    default:
+        return FALSE;
+    }
+
+    if (image == NULL || !spice_image_decoder_can_decode(image))
+        return FALSE;
+    surface = find_surface(c, base->surface_id);
+    if (surface == NULL)
+        return FALSE;
+    if (spice_msg_in_type(in) == SPICE_MSG_DISPLAY_DRAW_COPY &&
+        decode_in_place(spice_msg_in_parsed(in), surface))
+        return FALSE;
+
+    if (g_queue_get_length(&c->decode_pending) >= DECODE_PENDING_MAX)
+        decode_run_next(channel);
+
+    job = g_new0(decode_job, 1);
+    job->refs = 2;
+    job->state = DECODE_QUEUED;
+    job->in = in;
+    job->surface_id = base->surface_id;
+    job->format = surface->format;
+    job->image = image;
+    job->want_original = want_original;
+    spice_msg_in_ref(in);
+    g_queue_push_tail(&c->decode_pending, job);
+    g_thread_pool_push(c->decode_pool, job, NULL);
+    SPICE_TRACE(DISPLAY_DECODE, spice_msg_in_type(in), g_queue_get_length(&c->decode_pending));
+    return TRUE;
+}
+
+static void decode_pipeline_start(spice_display_channel *c)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* the coroutine decodes too */
+    if (n < 2)
+        return;
+
+    g_queue_init(&c->decode_pending);
+    c->decode_lock = g_mutex_new();
+    c->decode_cond = g_cond_new();
+    c->decode_pool = g_thread_pool_new(decode_job_run, c,
+                                       MIN(n - 1, DECODE_THREADS_MAX),
+                                       FALSE, NULL);
+    if (c->decode_pool == NULL)
+        g_warning("no decoding threads, images are decoded inline");
+}
+
+static void decode_pipeline_stop(spice_display_channel *c)
+{
+    decode_worker *worker;
+    decode_job *job;
+    GList *l;
+
+    if (c->decode_lock == NULL)
+        return;
+
+    /* the draws are dropped, let the threads skip their images */
+    g_mutex_lock(c->decode_lock);
+    for (l = c->decode_pending.head; l != NULL; l = l->next) {
+        job = l->data;
+        if (job->state == DECODE_QUEUED)
+            job->state = DECODE_DONE;
+    }
+    g_mutex_unlock(c->decode_lock);
+
+    if (c->decode_pool)
+        g_thread_pool_free(c->decode_pool, FALSE, TRUE);
+    c->decode_pool = NULL;
+
+    while ((job = g_queue_pop_head(&c->decode_pending)) != NULL) {
+        spice_msg_in_unref(job->in);
+        decode_job_unref(c, job);
+    }
+
+    while (c->decoders) {
+        worker = c->decoders->data;
+        spice_image_decoder_destroy(worker->decoder);
+        jpeg_decoder_destroy(worker->jpeg_decoder);
+        g_free(worker);
+        c->decoders = g_slist_delete_link(c->decoders, c->decoders);
+    }
+
+    g_cond_free(c->decode_cond);
+    g_mutex_free(c->decode_lock);
+    c->decode_lock = NULL;
+}
+
+/* ------------------------------------------------------------------ */
+
+/*
+ * The draws of lazy_draws are parsed by their handler only: before that,
+ * those clipped out entirely are dropped by looking at the raw message,
+ * when the canvas wouldn't have done anything with them either, that is
+ * when it wouldn't touch their images (see canvas_get_image_internal).
+ * This way their clip rects, images, palettes and glyphs are never
+ * expanded, nor their images decoded by the pipeline.
+ *
+ * The reads are checked against the message size, the offsets are those
+ * of the current protocol.
+ */
+typedef struct draw_view {
+    const uint8_t   *data;
+    size_t          size;
+    SpiceRect       box;
+    uint8_t         clip_type;
+    uint32_t        num_rects;
+    size_t          rects; /* offset of the clip rects */
+    size_t          draw;  /* offset of the draw specific part */
+} draw_view;
+
+static gboolean view_read8(const draw_view *v, size_t pos, uint8_t *val)
+{
+    if (pos >= v->size)
+        return FALSE;
+    *val = v->data[pos];
+    return TRUE;
+}
+
+static gboolean view_read32(const draw_view *v, size_t pos, uint32_t *val)
+{
+    uint32_t le;
+
+    if (pos > v->size || v->size - pos < 4)
+        return FALSE;
+    memcpy(&le, v->data + pos, 4);
+    *val = GUINT32_FROM_LE(le);
+    return TRUE;
+}
+
+static gboolean view_read_rect(const draw_view *v, size_t pos, SpiceRect *r)
+{
+    uint32_t top, left, bottom, right;
+
+    if (!view_read32(v, pos, &top) || !view_read32(v, pos + 4, &left) ||
+        !view_read32(v, pos + 8, &bottom) || !view_read32(v, pos + 12, &right))
+        return FALSE;
+    r->top = top;
+    r->left = left;
+    r->bottom = bottom;
+    r->right = right;
+    return TRUE;
+}
+
+/* SpiceMsgDisplayBase */
+static gboolean draw_view_init(draw_view *v, spice_msg_in *in)
+{
+    int len;
+
+    v->data = spice_msg_in_raw(in, &len);
+    v->size = len;
+    if (!view_read_rect(v, 4, &v->box) || !view_read8(v, 20, &v->clip_type))
+        return FALSE;
+
+    v->num_rects = 0;
+    v->rects = v->draw = 21;
+    if (v->clip_type == SPICE_CLIP_TYPE_RECTS) {
+        if (!view_read32(v, 21, &v->num_rects) ||
+            v->num_rects > (v->size - 25) / 16)
+            return FALSE;
+        v->rects = 25;
+        v->draw = 25 + v->num_rects * 16;
+    }
+    return TRUE;
+}
+
+static gboolean draw_view_clipped(const draw_view *v)
+{
+    SpiceRect r;
+    uint32_t i;
+
+    if (v->box.right <= v->box.left || v->box.bottom <= v->box.top)
+        return TRUE;
+
+    switch (v->clip_type) {
+    case SPICE_CLIP_TYPE_NONE:
+        return FALSE;
+    case SPICE_CLIP_TYPE_RECTS:
+        for (i = 0; i < v->num_rects; i++) {
+            view_read_rect(v, v->rects + i * 16, &r);
+            if (MAX(r.left, v->box.left) < MIN(r.right, v->box.right) &&
+                MAX(r.top, v->box.top) < MIN(r.bottom, v->box.bottom))
+                return FALSE;
+        }
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* whether canvas_touch_image() ignores the image pointed at from pos */
+static gboolean draw_view_image_untouched(const draw_view *v, size_t pos)
+{
+    uint32_t image;
+    uint8_t type, flags;
+
+    if (!view_read32(v, pos, &image))
+        return FALSE;
+    if (image == 0)
+        return TRUE;
+    /* SpiceImageDescriptor: id, type, flags, width, height */
+    if (image >= v->size || v->size - image < 18)
+        return FALSE;
+    type = v->data[image + 8];
+    flags = v->data[image + 9];
+    return !(flags & (SPICE_IMAGE_FLAGS_CACHE_ME | SPICE_IMAGE_FLAGS_CACHE_REPLACE_ME)) &&
+        type != SPICE_IMAGE_TYPE_GLZ_RGB && type != SPICE_IMAGE_TYPE_ZLIB_GLZ_RGB;
+}
+
+/* the canvas gets the masks before it knows the draw is clipped out */
+static gboolean draw_view_no_mask(const draw_view *v, size_t pos)
+{
+    uint32_t bitmap;
+
+    /* SpiceQMask: flags, pos, bitmap */
+    return view_read32(v, pos + 9, &bitmap) && bitmap == 0;
+}
+
+/* SpiceBrush at *pos, moves past it */
+static gboolean draw_view_brush_untouched(const draw_view *v, size_t *pos)
+{
+    uint8_t type;
+
+    if (!view_read8(v, *pos, &type))
+        return FALSE;
+    switch (type) {
+    case SPICE_BRUSH_TYPE_NONE:
+        *pos += 1;
+        return TRUE;
+    case SPICE_BRUSH_TYPE_SOLID:
+        *pos += 5;
+        return TRUE;
+    case SPICE_BRUSH_TYPE_PATTERN:
+        *pos += 13;
+        return draw_view_image_untouched(v, *pos - 12);
+    default:
+        return FALSE;
+    }
+}
+
+/* coroutine context, whether the draw would be a no-op */
+static gboolean draw_view_dropped(SpiceChannel *channel, spice_msg_in *in)
+{
+    draw_view v;
+    size_t pos;
+
+    if (!in->parse_pending ||
+        SPICE_CHANNEL(channel)->priv->peer_hdr.major_version != SPICE_VERSION_MAJOR)
+        return FALSE;
+    if (!draw_view_init(&v, in) || !draw_view_clipped(&v))
+        return FALSE;
+
+    switch (spice_msg_in_type(in)) {
+    case SPICE_MSG_DISPLAY_DRAW_COPY:
+    case SPICE_MSG_DISPLAY_DRAW_BLEND:
+        /* src_bitmap, src_area, rop_descriptor, scale_mode, mask */
+        return draw_view_image_untouched(&v, v.draw) &&
+            draw_view_no_mask(&v, v.draw + 23);
+    case SPICE_MSG_DISPLAY_DRAW_OPAQUE:
+        /* src_bitmap, src_area, brush, rop_descriptor, scale_mode, mask */
+        pos = v.draw + 20;
+        return draw_view_image_untouched(&v, v.draw) &&
+            draw_view_brush_untouched(&v, &pos) &&
+            draw_view_no_mask(&v, pos + 3);
+    case SPICE_MSG_DISPLAY_DRAW_TEXT:
+        /* str, back_area, fore_brush, back_brush, fore_mode, back_mode */
+        pos = v.draw + 20;
+        return draw_view_brush_untouched(&v, &pos) &&
+            draw_view_brush_untouched(&v, &pos);
+    case SPICE_MSG_DISPLAY_DRAW_TRANSPARENT:
+        /* src_bitmap, src_area, src_color, true_color */
+        return draw_view_image_untouched(&v, v.draw);
+    case SPICE_MSG_DISPLAY_DRAW_ALPHA_BLEND:
+        /* alpha_flags, alpha, src_bitmap, src_area */
+        return draw_view_image_untouched(&v, v.draw + 2);
+    default:
+        return FALSE;
+    }
+}
+
 /* coroutine context */
 static void spice_display_handle_msg(SpiceChannel *channel, spice_msg_in *msg)
 {
     int type = spice_msg_in_type(msg);
-    SPICE_DEBUG("Got spice_display_handle_msg:%d",type);
+    SPICE_TRACE(DISPLAY_MSG, type);
     g_return_if_fail(type < SPICE_N_ELEMENTS(display_handlers));
     g_return_if_fail(display_handlers[type] != NULL);
-    display_handlers[type](channel, msg);
+
+    if (draw_view_dropped(channel, msg)) {
+        SPICE_TRACE(DISPLAY_DROP, type);
+        return;
+    }
+
+    if (!decode_job_new(channel, msg)) {
+        decode_flush(channel);
+        display_handlers[type](channel, msg);
+    }
+}
+
+/* coroutine context */
+static void spice_display_read_idle(SpiceChannel *channel)
+{
+    decode_flush(channel);
 }
@@ -561,7 +561,7 @@ static void do_emit_main_context(GObject *object, int signum, gpointer params)
 
 /* ------------------------------------------------------------------ */
 
-/* coroutine context */
+/* coroutine context, the messages are written together */
 static void agent_send_msg_queue(SpiceMainChannel *channel)
 {
     spice_main_channel *c = channel->priv;
@@ -571,7 +571,7 @@ static void agent_send_msg_queue(SpiceMainChannel *channel)
            !g_queue_is_empty(c->agent_msg_queue)) {
         c->agent_tokens--;
         out = g_queue_pop_head(c->agent_msg_queue);
-        spice_msg_out_send_internal(out);
+        spice_msg_out_queue(out);
         spice_msg_out_unref(out);
     }
 }
@@ -226,6 +226,36 @@ static void do_emit_main_context(GObject *object, int signum, gpointer params)
     }
 }
 
+/* the samples are copied, the message is gone when they are emitted */
+static void free_data(gpointer params)
+{
+    struct SPICE_PLAYBACK_DATA *p = params;
+
+    g_free(p->data);
+}
+
+/* consecutive packets are played as one, up to this many bytes */
+#define PLAYBACK_COALESCE_MAX (64 * 1024)
+
+static gboolean coalesce_data(int signum, gpointer queued, gconstpointer params)
+{
+    struct SPICE_PLAYBACK_DATA *q = queued;
+    const struct SPICE_PLAYBACK_DATA *p = params;
+
+    if (q->data_size + p->data_size > PLAYBACK_COALESCE_MAX)
+        return FALSE;
+    q->data = g_realloc(q->data, q->data_size + p->data_size);
+    memcpy(q->data + q->data_size, p->data, p->data_size);
+    q->data_size += p->data_size;
+    return TRUE;
+}
+
+static void emit_data(SpiceChannel *channel, uint8_t *data, gsize size)
+{
+    emit_main_context_async(channel, coalesce_data, free_data,
+                            SPICE_PLAYBACK_DATA, g_memdup(data, size), size);
+}
+
 /* ------------------------------------------------------------------ */
 
 /* coroutine context */
@@ -246,8 +276,7 @@ static void playback_handle_data(SpiceChannel *channel, spice_msg_in *in)
 
     switch (c->mode) {
     case SPICE_AUDIO_DATA_MODE_RAW:
-        emit_main_context(channel, SPICE_PLAYBACK_DATA,
-                          packet->data, packet->data_size);
+        emit_data(channel, packet->data, packet->data_size);
         break;
     case SPICE_AUDIO_DATA_MODE_CELT_0_5_1: {
         celt_int16_t pcm[256 * 2];
@@ -260,8 +289,7 @@ static void playback_handle_data(SpiceChannel *channel, spice_msg_in *in)
             return;
         }
 
-        emit_main_context(channel, SPICE_PLAYBACK_DATA,
-                          (uint8_t *)pcm, sizeof(pcm));
+        emit_data(channel, (uint8_t *)pcm, sizeof(pcm));
         break;
     }
     default:
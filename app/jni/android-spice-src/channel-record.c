@@ -318,7 +318,8 @@ void spice_record_send_data(SpiceRecordChannel *channel, gpointer data,
 
         msg = spice_msg_out_new(SPICE_CHANNEL(channel), SPICE_MSGC_RECORD_DATA);
         msg->marshallers->msgc_record_data(msg->marshaller, &p);
-        spice_marshaller_add(msg->marshaller, frame, frame_size);
+        /* written before spice_msg_out_send() returns */
+        spice_marshaller_add_ref(msg->marshaller, frame, frame_size);
         spice_msg_out_send(msg);
         spice_msg_out_unref(msg);
 
@@ -121,8 +121,10 @@
 /* Have pulseaudio? */
 #define WITH_PULSE 1
 
-/* Whether to use ucontext coroutine impl */
+/* Whether to use ucontext coroutine impl, see SPICE_COROUTINE in Android.mk */
+#ifndef WITH_UCONTEXT
 #define WITH_UCONTEXT 0
+#endif
 
 /* Use X11 backend? */
 /* #undef WITH_X11 */
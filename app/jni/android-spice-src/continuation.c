@@ -0,0 +1,258 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "continuation.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* all the continuations live in the thread running the main loop */
+static struct continuation *starting;
+
+static void cc_switch_to(struct continuation *from, struct continuation *to);
+
+static void cc_trampoline(void)
+{
+	struct continuation *cc = starting;
+
+	cc->entry(cc);
+	cc->exited = 1;
+	cc_switch_to(cc, cc->last);
+
+	fprintf(stderr, "Continuation resumed after its exit\n");
+	abort();
+}
+
+#ifdef CONTINUATION_UCONTEXT
+
+static int cc_prepare(struct continuation *cc)
+{
+	if (getcontext(&cc->uc) == -1)
+		return -1;
+
+	cc->uc.uc_link = NULL;
+	cc->uc.uc_stack.ss_sp = cc->stack;
+	cc->uc.uc_stack.ss_size = cc->stack_size;
+	cc->uc.uc_stack.ss_flags = 0;
+	makecontext(&cc->uc, cc_trampoline, 0);
+	return 0;
+}
+
+static void cc_switch_to(struct continuation *from, struct continuation *to)
+{
+	swapcontext(&from->uc, &to->uc);
+}
+
+#else
+
+/*
+ * cc_switch() pushes the callee-saved registers and the return address
+ * on the current stack, saves the stack pointer to *save and pops the
+ * same from new_sp. A new stack gets a fake frame whose return address
+ * is cc_trampoline(), laid out so that the stack is aligned as the ABI
+ * wants it at a function entry.
+ */
+void cc_switch(void **save, void *new_sp) __attribute__((visibility("hidden")));
+
+#if defined(__x86_64__)
+
+#define CC_FRAME_SIZE 64 /* rbp rbx r12-r15, return address, padding */
+#define CC_FRAME_PC   6
+
+__asm__(
+	".pushsection .text\n"
+	".globl cc_switch\n"
+	".hidden cc_switch\n"
+	".type cc_switch, @function\n"
+	"cc_switch:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size cc_switch, .-cc_switch\n"
+	".popsection\n");
+
+#elif defined(__i386__)
+
+#define CC_FRAME_SIZE 24 /* ebp ebx esi edi, return address, padding */
+#define CC_FRAME_PC   4
+
+__asm__(
+	".pushsection .text\n"
+	".globl cc_switch\n"
+	".hidden cc_switch\n"
+	".type cc_switch, @function\n"
+	"cc_switch:\n"
+	"	movl 4(%esp), %eax\n"
+	"	movl 8(%esp), %edx\n"
+	"	pushl %ebp\n"
+	"	pushl %ebx\n"
+	"	pushl %esi\n"
+	"	pushl %edi\n"
+	"	movl %esp, (%eax)\n"
+	"	movl %edx, %esp\n"
+	"	popl %edi\n"
+	"	popl %esi\n"
+	"	popl %ebx\n"
+	"	popl %ebp\n"
+	"	ret\n"
+	".size cc_switch, .-cc_switch\n"
+	".popsection\n");
+
+#elif defined(__aarch64__)
+
+#define CC_FRAME_SIZE 160 /* x19-x30, d8-d15 */
+#define CC_FRAME_PC   11
+
+__asm__(
+	".pushsection .text\n"
+	".globl cc_switch\n"
+	".hidden cc_switch\n"
+	".type cc_switch, %function\n"
+	"cc_switch:\n"
+	"	sub sp, sp, #160\n"
+	"	stp x19, x20, [sp, #0]\n"
+	"	stp x21, x22, [sp, #16]\n"
+	"	stp x23, x24, [sp, #32]\n"
+	"	stp x25, x26, [sp, #48]\n"
+	"	stp x27, x28, [sp, #64]\n"
+	"	stp x29, x30, [sp, #80]\n"
+	"	stp d8, d9, [sp, #96]\n"
+	"	stp d10, d11, [sp, #112]\n"
+	"	stp d12, d13, [sp, #128]\n"
+	"	stp d14, d15, [sp, #144]\n"
+	"	mov x2, sp\n"
+	"	str x2, [x0]\n"
+	"	mov sp, x1\n"
+	"	ldp x19, x20, [sp, #0]\n"
+	"	ldp x21, x22, [sp, #16]\n"
+	"	ldp x23, x24, [sp, #32]\n"
+	"	ldp x25, x26, [sp, #48]\n"
+	"	ldp x27, x28, [sp, #64]\n"
+	"	ldp x29, x30, [sp, #80]\n"
+	"	ldp d8, d9, [sp, #96]\n"
+	"	ldp d10, d11, [sp, #112]\n"
+	"	ldp d12, d13, [sp, #128]\n"
+	"	ldp d14, d15, [sp, #144]\n"
+	"	add sp, sp, #160\n"
+	"	ret\n"
+	".size cc_switch, .-cc_switch\n"
+	".popsection\n");
+
+#elif defined(__arm__)
+
+/* r12 is only there to keep the stack 8 bytes aligned */
+#if defined(__VFP_FP__) && !defined(__SOFTFP__)
+#define CC_FRAME_SIZE 104 /* d8-d15, r4-r12, pc */
+#define CC_FRAME_PC   25
+#define CC_VPUSH      "	vpush {d8-d15}\n"
+#define CC_VPOP       "	vpop {d8-d15}\n"
+#else
+#define CC_FRAME_SIZE 40 /* r4-r12, pc */
+#define CC_FRAME_PC   9
+#define CC_VPUSH
+#define CC_VPOP
+#endif
+#ifdef __thumb__
+#define CC_MODE       ".thumb\n"
+#else
+#define CC_MODE
+#endif
+
+/* ARM state, so that r8-r11 can be pushed on armv5 too; pc is loaded
+ * with ldm, which interworks with Thumb callers and trampoline */
+__asm__(
+	".pushsection .text\n"
+	".arm\n"
+	".align 2\n"
+	".globl cc_switch\n"
+	".hidden cc_switch\n"
+	".type cc_switch, %function\n"
+	"cc_switch:\n"
+	"	push {r4-r12, lr}\n"
+	CC_VPUSH
+	"	str sp, [r0]\n"
+	"	mov sp, r1\n"
+	CC_VPOP
+	"	pop {r4-r12, pc}\n"
+	".size cc_switch, .-cc_switch\n"
+	CC_MODE
+	".popsection\n");
+
+#endif
+
+static int cc_prepare(struct continuation *cc)
+{
+	uintptr_t top = ((uintptr_t)cc->stack + cc->stack_size) & ~(uintptr_t)15;
+	void **frame = (void **)(top - CC_FRAME_SIZE);
+
+	memset(frame, 0, CC_FRAME_SIZE);
+	frame[CC_FRAME_PC] = (void *)cc_trampoline;
+	cc->sp = frame;
+	return 0;
+}
+
+static void cc_switch_to(struct continuation *from, struct continuation *to)
+{
+	cc_switch(&from->sp, to->sp);
+}
+
+#endif
+
+int cc_init(struct continuation *cc)
+{
+	cc->last = NULL;
+	cc->exited = 0;
+	return cc_prepare(cc);
+}
+
+int cc_release(struct continuation *cc)
+{
+	if (cc->release)
+		return cc->release(cc);
+
+	return 0;
+}
+
+int cc_swap(struct continuation *from, struct continuation *to)
+{
+	to->last = from;
+	starting = to;
+	cc_switch_to(from, to);
+
+	return to->exited;
+}
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ *  tab-width: 8
+ * End:
+ */
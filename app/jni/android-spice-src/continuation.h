@@ -0,0 +1,68 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef _CONTINUATION_H_
+#define _CONTINUATION_H_
+
+#include <stddef.h>
+
+/*
+ * The stacks are switched by a few instructions saving the callee-saved
+ * registers on arm, arm64, x86 and x86_64, or by swapcontext() elsewhere
+ * or when CONTINUATION_UCONTEXT is defined (bionic has no ucontext).
+ */
+#if !defined(CONTINUATION_UCONTEXT) && \
+    !defined(__arm__) && !defined(__aarch64__) && \
+    !defined(__i386__) && !defined(__x86_64__)
+#define CONTINUATION_UCONTEXT 1
+#endif
+
+#ifdef CONTINUATION_UCONTEXT
+#include <ucontext.h>
+#endif
+
+struct continuation
+{
+	char *stack;
+	size_t stack_size;
+	void (*entry)(struct continuation *cc);
+	int (*release)(struct continuation *cc);
+
+	/* private */
+	struct continuation *last; /* resumed when entry returns */
+	int exited;
+#ifdef CONTINUATION_UCONTEXT
+	ucontext_t uc;
+#else
+	void *sp; /* saved registers are on top of the stack */
+#endif
+};
+
+int cc_init(struct continuation *cc);
+
+int cc_release(struct continuation *cc);
+
+/* returns 1 if to's entry returned, 0 if something swapped back to from */
+int cc_swap(struct continuation *from, struct continuation *to);
+
+#endif
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ *  tab-width: 8
+ * End:
+ */
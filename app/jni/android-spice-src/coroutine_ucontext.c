@@ -0,0 +1,159 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "coroutine.h"
+
+/*
+ * Coroutines switching stacks in the calling thread (see continuation.c),
+ * instead of handing a lock over between threads as coroutine_gthread.c
+ * does: a swap is a few dozen instructions, no system call.
+ */
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+static struct coroutine *current;
+static struct coroutine leader;
+
+static int _coroutine_release(struct continuation *cc)
+{
+	struct coroutine *co = container_of(cc, struct coroutine, cc);
+
+	if (co->release) {
+		int ret = co->release(co);
+		if (ret < 0)
+			return ret;
+	}
+
+	/* the guard page below the stack goes with it */
+	munmap((char *)co->cc.stack - getpagesize(),
+	       co->cc.stack_size + getpagesize());
+
+	co->caller = NULL;
+
+	return 0;
+}
+
+static void coroutine_trampoline(struct continuation *cc)
+{
+	struct coroutine *co = container_of(cc, struct coroutine, cc);
+
+	co->data = co->entry(co->data);
+}
+
+int coroutine_init(struct coroutine *co)
+{
+	size_t page = getpagesize();
+	char *base;
+
+	if (co->stack_size == 0)
+		co->stack_size = 16 << 20;
+
+	/* one more page, left inaccessible below the stack so that an
+	   overflow faults instead of scribbling over a neighbour mapping */
+	base = mmap(0, co->stack_size + page,
+		    PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS,
+		    -1, 0);
+	if (base == MAP_FAILED) {
+		fprintf(stderr, "Failed to allocate %u bytes for coroutine stack: %s\n",
+			(unsigned)co->stack_size, strerror(errno));
+		return -1;
+	}
+	if (mprotect(base, page, PROT_NONE) < 0) {
+		fprintf(stderr, "Failed to protect coroutine stack guard: %s\n",
+			strerror(errno));
+		munmap(base, co->stack_size + page);
+		return -1;
+	}
+	co->cc.stack_size = co->stack_size;
+	co->cc.stack = base + page;
+	co->cc.entry = coroutine_trampoline;
+	co->cc.release = _coroutine_release;
+	co->exited = 0;
+	co->caller = NULL;
+
+	return cc_init(&co->cc);
+}
+
+int coroutine_release(struct coroutine *co)
+{
+	return cc_release(&co->cc);
+}
+
+void *coroutine_swap(struct coroutine *from, struct coroutine *to, void *arg)
+{
+	to->data = arg;
+	current = to;
+	if (cc_swap(&from->cc, &to->cc) == 0)
+		return from->data;
+
+	/* to's entry returned, we are back on from's stack */
+	coroutine_release(to);
+	current = from;
+	to->exited = 1;
+	return to->data;
+}
+
+struct coroutine *coroutine_self(void)
+{
+	if (current == NULL)
+		current = &leader;
+	return current;
+}
+
+void *coroutine_yieldto(struct coroutine *to, void *arg)
+{
+	if (to->caller) {
+		fprintf(stderr, "Co-routine is re-entering itself\n");
+		abort();
+	}
+	to->caller = coroutine_self();
+	return coroutine_swap(coroutine_self(), to, arg);
+}
+
+void *coroutine_yield(void *arg)
+{
+	struct coroutine *to = coroutine_self()->caller;
+	if (!to) {
+		fprintf(stderr, "Co-routine is yielding to no one\n");
+		abort();
+	}
+
+	coroutine_self()->caller = NULL;
+	return coroutine_swap(coroutine_self(), to, arg);
+}
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ *  tab-width: 8
+ * End:
+ */
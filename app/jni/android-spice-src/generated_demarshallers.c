@@ -167,7 +167,7 @@ static uint8_t * parse_msg_migrate(uint8_t *message_start, uint8_t *message_end,
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -182,12 +182,12 @@ static uint8_t * parse_msg_migrate(uint8_t *message_start, uint8_t *message_end,
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -246,7 +246,7 @@ static uint8_t * parse_msg_set_ack(uint8_t *message_start, uint8_t *message_end,
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -262,12 +262,12 @@ static uint8_t * parse_msg_set_ack(uint8_t *message_start, uint8_t *message_end,
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -298,7 +298,7 @@ static uint8_t * parse_msg_ping(uint8_t *message_start, uint8_t *message_end, in
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -318,12 +318,12 @@ static uint8_t * parse_msg_ping(uint8_t *message_start, uint8_t *message_end, in
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -362,7 +362,7 @@ static uint8_t * parse_msg_wait_for_channels(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -386,12 +386,12 @@ static uint8_t * parse_msg_wait_for_channels(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -414,7 +414,7 @@ static uint8_t * parse_msg_disconnecting(uint8_t *message_start, uint8_t *messag
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -430,12 +430,12 @@ static uint8_t * parse_msg_disconnecting(uint8_t *message_start, uint8_t *messag
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -473,7 +473,7 @@ static uint8_t * parse_msg_notify(uint8_t *message_start, uint8_t *message_end,
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -495,12 +495,12 @@ static uint8_t * parse_msg_notify(uint8_t *message_start, uint8_t *message_end,
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -605,7 +605,7 @@ static uint8_t * parse_msg_main_migrate_begin(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -649,12 +649,12 @@ static uint8_t * parse_msg_main_migrate_begin(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -677,7 +677,7 @@ static uint8_t * parse_SpiceMsgEmpty(uint8_t *message_start, uint8_t *message_en
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -691,12 +691,12 @@ static uint8_t * parse_SpiceMsgEmpty(uint8_t *message_start, uint8_t *message_en
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -719,7 +719,7 @@ static uint8_t * parse_msg_main_init(uint8_t *message_start, uint8_t *message_en
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -741,12 +741,12 @@ static uint8_t * parse_msg_main_init(uint8_t *message_start, uint8_t *message_en
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -785,7 +785,7 @@ static uint8_t * parse_msg_main_channels_list(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -808,12 +808,12 @@ static uint8_t * parse_msg_main_channels_list(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -836,7 +836,7 @@ static uint8_t * parse_msg_main_mouse_mode(uint8_t *message_start, uint8_t *mess
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -852,12 +852,12 @@ static uint8_t * parse_msg_main_mouse_mode(uint8_t *message_start, uint8_t *mess
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -880,7 +880,7 @@ static uint8_t * parse_msg_main_multi_media_time(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -895,12 +895,12 @@ static uint8_t * parse_msg_main_multi_media_time(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -923,7 +923,7 @@ static uint8_t * parse_msg_main_agent_disconnected(uint8_t *message_start, uint8
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -938,12 +938,12 @@ static uint8_t * parse_msg_main_agent_disconnected(uint8_t *message_start, uint8
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -966,7 +966,7 @@ static uint8_t * parse_msg_main_agent_token(uint8_t *message_start, uint8_t *mes
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -981,12 +981,12 @@ static uint8_t * parse_msg_main_agent_token(uint8_t *message_start, uint8_t *mes
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1073,7 +1073,7 @@ static uint8_t * parse_msg_main_migrate_switch_host(uint8_t *message_start, uint
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1116,12 +1116,12 @@ static uint8_t * parse_msg_main_migrate_switch_host(uint8_t *message_start, uint
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1178,7 +1178,7 @@ static uint8_t * parse_msg_display_mode(uint8_t *message_start, uint8_t *message
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1195,12 +1195,12 @@ static uint8_t * parse_msg_display_mode(uint8_t *message_start, uint8_t *message
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1305,7 +1305,7 @@ static uint8_t * parse_msg_display_copy_bits(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1357,12 +1357,12 @@ static uint8_t * parse_msg_display_copy_bits(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1401,7 +1401,7 @@ static uint8_t * parse_msg_display_inval_list(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1424,12 +1424,12 @@ static uint8_t * parse_msg_display_inval_list(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1468,7 +1468,7 @@ static uint8_t * parse_msg_display_inval_all_pixmaps(uint8_t *message_start, uin
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1492,12 +1492,12 @@ static uint8_t * parse_msg_display_inval_all_pixmaps(uint8_t *message_start, uin
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1520,7 +1520,7 @@ static uint8_t * parse_msg_display_inval_palette(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1535,12 +1535,12 @@ static uint8_t * parse_msg_display_inval_palette(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1612,7 +1612,7 @@ static uint8_t * parse_msg_display_stream_create(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1666,12 +1666,12 @@ static uint8_t * parse_msg_display_stream_create(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1709,7 +1709,7 @@ static uint8_t * parse_msg_display_stream_data(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1729,12 +1729,12 @@ static uint8_t * parse_msg_display_stream_data(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1806,7 +1806,7 @@ static uint8_t * parse_msg_display_stream_clip(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1846,12 +1846,12 @@ static uint8_t * parse_msg_display_stream_clip(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1874,7 +1874,7 @@ static uint8_t * parse_msg_display_stream_destroy(uint8_t *message_start, uint8_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1889,12 +1889,12 @@ static uint8_t * parse_msg_display_stream_destroy(uint8_t *message_start, uint8_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -2535,7 +2535,7 @@ static uint8_t * parse_msg_display_draw_fill(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -2612,12 +2612,12 @@ static uint8_t * parse_msg_display_draw_fill(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -2786,7 +2786,7 @@ static uint8_t * parse_msg_display_draw_opaque(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -2874,12 +2874,12 @@ static uint8_t * parse_msg_display_draw_opaque(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3000,7 +3000,7 @@ static uint8_t * parse_msg_display_draw_copy(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3073,12 +3073,12 @@ static uint8_t * parse_msg_display_draw_copy(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3199,7 +3199,7 @@ static uint8_t * parse_msg_display_draw_blend(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3272,12 +3272,12 @@ static uint8_t * parse_msg_display_draw_blend(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3383,7 +3383,7 @@ static uint8_t * parse_msg_display_draw_blackness(uint8_t *message_start, uint8_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3444,12 +3444,12 @@ static uint8_t * parse_msg_display_draw_blackness(uint8_t *message_start, uint8_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3555,7 +3555,7 @@ static uint8_t * parse_msg_display_draw_whiteness(uint8_t *message_start, uint8_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3616,12 +3616,12 @@ static uint8_t * parse_msg_display_draw_whiteness(uint8_t *message_start, uint8_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3727,7 +3727,7 @@ static uint8_t * parse_msg_display_draw_invers(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3788,12 +3788,12 @@ static uint8_t * parse_msg_display_draw_invers(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3962,7 +3962,7 @@ static uint8_t * parse_msg_display_draw_rop3(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -4050,12 +4050,12 @@ static uint8_t * parse_msg_display_draw_rop3(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -4397,7 +4397,7 @@ static uint8_t * parse_msg_display_draw_stroke(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -4483,12 +4483,12 @@ static uint8_t * parse_msg_display_draw_stroke(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -4975,7 +4975,7 @@ static uint8_t * parse_msg_display_draw_text(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5067,12 +5067,12 @@ static uint8_t * parse_msg_display_draw_text(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5172,7 +5172,7 @@ static uint8_t * parse_msg_display_draw_transparent(uint8_t *message_start, uint
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5234,12 +5234,12 @@ static uint8_t * parse_msg_display_draw_transparent(uint8_t *message_start, uint
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5339,7 +5339,7 @@ static uint8_t * parse_msg_display_draw_alpha_blend(uint8_t *message_start, uint
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5401,12 +5401,12 @@ static uint8_t * parse_msg_display_draw_alpha_blend(uint8_t *message_start, uint
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5429,7 +5429,7 @@ static uint8_t * parse_msg_display_surface_create(uint8_t *message_start, uint8_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5448,12 +5448,12 @@ static uint8_t * parse_msg_display_surface_create(uint8_t *message_start, uint8_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5476,7 +5476,7 @@ static uint8_t * parse_msg_display_surface_destroy(uint8_t *message_start, uint8
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5491,12 +5491,12 @@ static uint8_t * parse_msg_display_surface_destroy(uint8_t *message_start, uint8
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5577,7 +5577,7 @@ static uint8_t * parse_msg_inputs_init(uint8_t *message_start, uint8_t *message_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5592,12 +5592,12 @@ static uint8_t * parse_msg_inputs_init(uint8_t *message_start, uint8_t *message_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5620,7 +5620,7 @@ static uint8_t * parse_msg_inputs_key_modifiers(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5635,12 +5635,12 @@ static uint8_t * parse_msg_inputs_key_modifiers(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5724,7 +5724,7 @@ static uint8_t * parse_msg_cursor_init(uint8_t *message_start, uint8_t *message_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5762,12 +5762,12 @@ static uint8_t * parse_msg_cursor_init(uint8_t *message_start, uint8_t *message_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5821,7 +5821,7 @@ static uint8_t * parse_msg_cursor_set(uint8_t *message_start, uint8_t *message_e
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5857,12 +5857,12 @@ static uint8_t * parse_msg_cursor_set(uint8_t *message_start, uint8_t *message_e
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5885,7 +5885,7 @@ static uint8_t * parse_msg_cursor_move(uint8_t *message_start, uint8_t *message_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5903,12 +5903,12 @@ static uint8_t * parse_msg_cursor_move(uint8_t *message_start, uint8_t *message_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5931,7 +5931,7 @@ static uint8_t * parse_msg_cursor_trail(uint8_t *message_start, uint8_t *message
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5947,12 +5947,12 @@ static uint8_t * parse_msg_cursor_trail(uint8_t *message_start, uint8_t *message
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5975,7 +5975,7 @@ static uint8_t * parse_msg_cursor_inval_one(uint8_t *message_start, uint8_t *mes
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5990,12 +5990,12 @@ static uint8_t * parse_msg_cursor_inval_one(uint8_t *message_start, uint8_t *mes
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6057,7 +6057,7 @@ static uint8_t * parse_msg_playback_data(uint8_t *message_start, uint8_t *messag
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6076,12 +6076,12 @@ static uint8_t * parse_msg_playback_data(uint8_t *message_start, uint8_t *messag
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6112,7 +6112,7 @@ static uint8_t * parse_msg_playback_mode(uint8_t *message_start, uint8_t *messag
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6132,12 +6132,12 @@ static uint8_t * parse_msg_playback_mode(uint8_t *message_start, uint8_t *messag
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6160,7 +6160,7 @@ static uint8_t * parse_msg_playback_start(uint8_t *message_start, uint8_t *messa
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6178,12 +6178,12 @@ static uint8_t * parse_msg_playback_start(uint8_t *message_start, uint8_t *messa
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6233,7 +6233,7 @@ static uint8_t * parse_msg_record_start(uint8_t *message_start, uint8_t *message
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6250,12 +6250,12 @@ static uint8_t * parse_msg_record_start(uint8_t *message_start, uint8_t *message
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6303,7 +6303,7 @@ static uint8_t * parse_msg_tunnel_init(uint8_t *message_start, uint8_t *message_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6319,12 +6319,12 @@ static uint8_t * parse_msg_tunnel_init(uint8_t *message_start, uint8_t *message_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6372,7 +6372,7 @@ static uint8_t * parse_msg_tunnel_service_ip_map(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6396,12 +6396,12 @@ static uint8_t * parse_msg_tunnel_service_ip_map(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6424,7 +6424,7 @@ static uint8_t * parse_msg_tunnel_socket_open(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6441,12 +6441,12 @@ static uint8_t * parse_msg_tunnel_socket_open(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6469,7 +6469,7 @@ static uint8_t * parse_msg_tunnel_socket_fin(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6484,12 +6484,12 @@ static uint8_t * parse_msg_tunnel_socket_fin(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6512,7 +6512,7 @@ static uint8_t * parse_msg_tunnel_socket_close(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6527,12 +6527,12 @@ static uint8_t * parse_msg_tunnel_socket_close(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6564,7 +6564,7 @@ static uint8_t * parse_msg_tunnel_socket_data(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6582,12 +6582,12 @@ static uint8_t * parse_msg_tunnel_socket_data(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6610,7 +6610,7 @@ static uint8_t * parse_msg_tunnel_socket_closed_ack(uint8_t *message_start, uint
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6625,12 +6625,12 @@ static uint8_t * parse_msg_tunnel_socket_closed_ack(uint8_t *message_start, uint
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -6653,7 +6653,7 @@ static uint8_t * parse_msg_tunnel_socket_token(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -6669,12 +6669,12 @@ static uint8_t * parse_msg_tunnel_socket_token(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
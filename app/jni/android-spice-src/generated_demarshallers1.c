@@ -144,7 +144,7 @@ static uint8_t * parse_msg_migrate(uint8_t *message_start, uint8_t *message_end,
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -159,12 +159,12 @@ static uint8_t * parse_msg_migrate(uint8_t *message_start, uint8_t *message_end,
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -223,7 +223,7 @@ static uint8_t * parse_msg_set_ack(uint8_t *message_start, uint8_t *message_end,
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -239,12 +239,12 @@ static uint8_t * parse_msg_set_ack(uint8_t *message_start, uint8_t *message_end,
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -275,7 +275,7 @@ static uint8_t * parse_msg_ping(uint8_t *message_start, uint8_t *message_end, in
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -295,12 +295,12 @@ static uint8_t * parse_msg_ping(uint8_t *message_start, uint8_t *message_end, in
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -339,7 +339,7 @@ static uint8_t * parse_msg_wait_for_channels(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -363,12 +363,12 @@ static uint8_t * parse_msg_wait_for_channels(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -391,7 +391,7 @@ static uint8_t * parse_msg_disconnecting(uint8_t *message_start, uint8_t *messag
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -407,12 +407,12 @@ static uint8_t * parse_msg_disconnecting(uint8_t *message_start, uint8_t *messag
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -455,7 +455,7 @@ static uint8_t * parse_msg_notify(uint8_t *message_start, uint8_t *message_end,
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -479,12 +479,12 @@ static uint8_t * parse_msg_notify(uint8_t *message_start, uint8_t *message_end,
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -538,7 +538,7 @@ static uint8_t * parse_msg_main_migrate_begin(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -578,12 +578,12 @@ static uint8_t * parse_msg_main_migrate_begin(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -606,7 +606,7 @@ static uint8_t * parse_SpiceMsgEmpty(uint8_t *message_start, uint8_t *message_en
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -620,12 +620,12 @@ static uint8_t * parse_SpiceMsgEmpty(uint8_t *message_start, uint8_t *message_en
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -648,7 +648,7 @@ static uint8_t * parse_msg_main_init(uint8_t *message_start, uint8_t *message_en
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -670,12 +670,12 @@ static uint8_t * parse_msg_main_init(uint8_t *message_start, uint8_t *message_en
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -714,7 +714,7 @@ static uint8_t * parse_msg_main_channels_list(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -737,12 +737,12 @@ static uint8_t * parse_msg_main_channels_list(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -765,7 +765,7 @@ static uint8_t * parse_msg_main_mouse_mode(uint8_t *message_start, uint8_t *mess
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -781,12 +781,12 @@ static uint8_t * parse_msg_main_mouse_mode(uint8_t *message_start, uint8_t *mess
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -809,7 +809,7 @@ static uint8_t * parse_msg_main_multi_media_time(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -824,12 +824,12 @@ static uint8_t * parse_msg_main_multi_media_time(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -852,7 +852,7 @@ static uint8_t * parse_msg_main_agent_disconnected(uint8_t *message_start, uint8
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -867,12 +867,12 @@ static uint8_t * parse_msg_main_agent_disconnected(uint8_t *message_start, uint8
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -895,7 +895,7 @@ static uint8_t * parse_msg_main_agent_token(uint8_t *message_start, uint8_t *mes
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -910,12 +910,12 @@ static uint8_t * parse_msg_main_agent_token(uint8_t *message_start, uint8_t *mes
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -966,7 +966,7 @@ static uint8_t * parse_msg_main_migrate_switch_host(uint8_t *message_start, uint
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -992,12 +992,12 @@ static uint8_t * parse_msg_main_migrate_switch_host(uint8_t *message_start, uint
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1054,7 +1054,7 @@ static uint8_t * parse_msg_display_mode(uint8_t *message_start, uint8_t *message
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1071,12 +1071,12 @@ static uint8_t * parse_msg_display_mode(uint8_t *message_start, uint8_t *message
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1211,7 +1211,7 @@ static uint8_t * parse_msg_display_copy_bits(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1264,12 +1264,12 @@ static uint8_t * parse_msg_display_copy_bits(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1308,7 +1308,7 @@ static uint8_t * parse_msg_display_inval_list(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1331,12 +1331,12 @@ static uint8_t * parse_msg_display_inval_list(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1375,7 +1375,7 @@ static uint8_t * parse_msg_display_inval_all_pixmaps(uint8_t *message_start, uin
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1399,12 +1399,12 @@ static uint8_t * parse_msg_display_inval_all_pixmaps(uint8_t *message_start, uin
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1427,7 +1427,7 @@ static uint8_t * parse_msg_display_inval_palette(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1442,12 +1442,12 @@ static uint8_t * parse_msg_display_inval_palette(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1508,7 +1508,7 @@ static uint8_t * parse_msg_display_stream_create(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1563,12 +1563,12 @@ static uint8_t * parse_msg_display_stream_create(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1606,7 +1606,7 @@ static uint8_t * parse_msg_display_stream_data(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1627,12 +1627,12 @@ static uint8_t * parse_msg_display_stream_data(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1693,7 +1693,7 @@ static uint8_t * parse_msg_display_stream_clip(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1734,12 +1734,12 @@ static uint8_t * parse_msg_display_stream_clip(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -1762,7 +1762,7 @@ static uint8_t * parse_msg_display_stream_destroy(uint8_t *message_start, uint8_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -1777,12 +1777,12 @@ static uint8_t * parse_msg_display_stream_destroy(uint8_t *message_start, uint8_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -2303,7 +2303,7 @@ static uint8_t * parse_msg_display_draw_fill(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -2384,12 +2384,12 @@ static uint8_t * parse_msg_display_draw_fill(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -2541,7 +2541,7 @@ static uint8_t * parse_msg_display_draw_opaque(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -2633,12 +2633,12 @@ static uint8_t * parse_msg_display_draw_opaque(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -2747,7 +2747,7 @@ static uint8_t * parse_msg_display_draw_copy(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -2821,12 +2821,12 @@ static uint8_t * parse_msg_display_draw_copy(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -2935,7 +2935,7 @@ static uint8_t * parse_msg_display_draw_blend(uint8_t *message_start, uint8_t *m
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3009,12 +3009,12 @@ static uint8_t * parse_msg_display_draw_blend(uint8_t *message_start, uint8_t *m
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3108,7 +3108,7 @@ static uint8_t * parse_msg_display_draw_blackness(uint8_t *message_start, uint8_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3170,12 +3170,12 @@ static uint8_t * parse_msg_display_draw_blackness(uint8_t *message_start, uint8_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3269,7 +3269,7 @@ static uint8_t * parse_msg_display_draw_whiteness(uint8_t *message_start, uint8_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3331,12 +3331,12 @@ static uint8_t * parse_msg_display_draw_whiteness(uint8_t *message_start, uint8_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3430,7 +3430,7 @@ static uint8_t * parse_msg_display_draw_invers(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3492,12 +3492,12 @@ static uint8_t * parse_msg_display_draw_invers(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -3649,7 +3649,7 @@ static uint8_t * parse_msg_display_draw_rop3(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -3741,12 +3741,12 @@ static uint8_t * parse_msg_display_draw_rop3(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -4047,7 +4047,7 @@ static uint8_t * parse_msg_display_draw_stroke(uint8_t *message_start, uint8_t *
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -4137,12 +4137,12 @@ static uint8_t * parse_msg_display_draw_stroke(uint8_t *message_start, uint8_t *
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -4605,7 +4605,7 @@ static uint8_t * parse_msg_display_draw_text(uint8_t *message_start, uint8_t *me
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -4704,12 +4704,12 @@ static uint8_t * parse_msg_display_draw_text(uint8_t *message_start, uint8_t *me
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -4797,7 +4797,7 @@ static uint8_t * parse_msg_display_draw_transparent(uint8_t *message_start, uint
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -4860,12 +4860,12 @@ static uint8_t * parse_msg_display_draw_transparent(uint8_t *message_start, uint
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -4953,7 +4953,7 @@ static uint8_t * parse_msg_display_draw_alpha_blend(uint8_t *message_start, uint
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5016,12 +5016,12 @@ static uint8_t * parse_msg_display_draw_alpha_blend(uint8_t *message_start, uint
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5100,7 +5100,7 @@ static uint8_t * parse_msg_inputs_init(uint8_t *message_start, uint8_t *message_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5115,12 +5115,12 @@ static uint8_t * parse_msg_inputs_init(uint8_t *message_start, uint8_t *message_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5143,7 +5143,7 @@ static uint8_t * parse_msg_inputs_key_modifiers(uint8_t *message_start, uint8_t
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5158,12 +5158,12 @@ static uint8_t * parse_msg_inputs_key_modifiers(uint8_t *message_start, uint8_t
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5230,7 +5230,7 @@ static uint8_t * parse_msg_cursor_init(uint8_t *message_start, uint8_t *message_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5268,12 +5268,12 @@ static uint8_t * parse_msg_cursor_init(uint8_t *message_start, uint8_t *message_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5310,7 +5310,7 @@ static uint8_t * parse_msg_cursor_set(uint8_t *message_start, uint8_t *message_e
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5346,12 +5346,12 @@ static uint8_t * parse_msg_cursor_set(uint8_t *message_start, uint8_t *message_e
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5374,7 +5374,7 @@ static uint8_t * parse_msg_cursor_move(uint8_t *message_start, uint8_t *message_
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5392,12 +5392,12 @@ static uint8_t * parse_msg_cursor_move(uint8_t *message_start, uint8_t *message_
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5420,7 +5420,7 @@ static uint8_t * parse_msg_cursor_trail(uint8_t *message_start, uint8_t *message
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5436,12 +5436,12 @@ static uint8_t * parse_msg_cursor_trail(uint8_t *message_start, uint8_t *message
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5464,7 +5464,7 @@ static uint8_t * parse_msg_cursor_inval_one(uint8_t *message_start, uint8_t *mes
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5479,12 +5479,12 @@ static uint8_t * parse_msg_cursor_inval_one(uint8_t *message_start, uint8_t *mes
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5546,7 +5546,7 @@ static uint8_t * parse_msg_playback_data(uint8_t *message_start, uint8_t *messag
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5565,12 +5565,12 @@ static uint8_t * parse_msg_playback_data(uint8_t *message_start, uint8_t *messag
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5601,7 +5601,7 @@ static uint8_t * parse_msg_playback_mode(uint8_t *message_start, uint8_t *messag
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5621,12 +5621,12 @@ static uint8_t * parse_msg_playback_mode(uint8_t *message_start, uint8_t *messag
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5649,7 +5649,7 @@ static uint8_t * parse_msg_playback_start(uint8_t *message_start, uint8_t *messa
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5667,12 +5667,12 @@ static uint8_t * parse_msg_playback_start(uint8_t *message_start, uint8_t *messa
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
@@ -5722,7 +5722,7 @@ static uint8_t * parse_msg_record_start(uint8_t *message_start, uint8_t *message
     }
 
     /* Validated extents and calculated size */
-    data = (uint8_t *)malloc(mem_size);
+    data = (uint8_t *)spice_parse_malloc(mem_size);
     if (SPICE_UNLIKELY(data == NULL)) {
         goto error;
     }
@@ -5739,12 +5739,12 @@ static uint8_t * parse_msg_record_start(uint8_t *message_start, uint8_t *message
     assert(end <= data + mem_size);
 
     *size = end - data;
-    *free_message = (message_destructor_t) free;
+    *free_message = spice_parse_free;
     return data;
 
    error:
     if (data != NULL) {
-        free(data);
+        spice_parse_free(data);
     }
     return NULL;
 }
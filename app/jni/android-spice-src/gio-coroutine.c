@@ -160,11 +160,94 @@ struct signal_data
     const char *debug_info;
 };
 
+/*
+ * Signals emitted with g_signal_emit_main_context_async() are queued per
+ * object and emitted together from a single idle callback. A synchronous
+ * emission on the same object first emits what is queued, so that the
+ * handlers see the signals in order.
+ */
+#define SIGNAL_QUEUE_MAX 256
+
+struct signal_event
+{
+    int signum;
+    GSignalEmitMainFunc func;
+    GDestroyNotify free_params;
+    gpointer params;
+};
+
+struct signal_queue
+{
+    GObject *object;
+    GArray *events;
+    guint idle_id;
+};
+
+static GQuark signal_queue_quark(void)
+{
+    static GQuark quark;
+
+    if (!quark)
+        quark = g_quark_from_static_string("spice-signal-queue");
+    return quark;
+}
+
+static void signal_event_clear(struct signal_event *event)
+{
+    if (event->free_params)
+        event->free_params(event->params);
+    g_free(event->params);
+}
+
+static void signal_queue_free(gpointer data)
+{
+    struct signal_queue *queue = data;
+    guint i;
+
+    for (i = 0; i < queue->events->len; i++)
+        signal_event_clear(&g_array_index(queue->events, struct signal_event, i));
+    g_array_free(queue->events, TRUE);
+    g_free(queue);
+}
+
+/* main context */
+static void signal_queue_flush(GObject *object)
+{
+    struct signal_queue *queue = g_object_get_qdata(object, signal_queue_quark());
+    struct signal_event event;
+    guint i;
+
+    if (queue == NULL)
+        return;
+
+    /* handlers may queue more events, the array can move */
+    for (i = 0; i < queue->events->len; i++) {
+        event = g_array_index(queue->events, struct signal_event, i);
+        event.func(object, event.signum, event.params);
+        signal_event_clear(&event);
+    }
+    g_array_set_size(queue->events, 0);
+}
+
+static gboolean signal_queue_idle(gpointer opaque)
+{
+    struct signal_queue *queue = opaque;
+    GObject *object = queue->object;
+
+    queue->idle_id = 0;
+    signal_queue_flush(object);
+    g_object_unref(object);
+
+    return FALSE;
+}
+
 static gboolean emit_main_context(gpointer opaque)
 {
     struct signal_data *signal = opaque;
 
-    signal->func(signal->object, signal->signum, signal->params);
+    signal_queue_flush(signal->object);
+    if (signal->func)
+        signal->func(signal->object, signal->signum, signal->params);
     coroutine_yieldto(signal->caller, NULL);
 
     return FALSE;
@@ -196,10 +279,66 @@ void g_signal_emit_main_context(GObject *object,
     coroutine_yield(NULL);
 }
 
+/* coroutine -> main context, returns as soon as the signal is queued.
+ * If @coalesce merges @params into the last queued event of the same
+ * signal, nothing more is queued. @params is copied, @free_params
+ * releases what it points to once emitted or merged. */
+void g_signal_emit_main_context_async(GObject *object,
+                                      GSignalEmitMainFunc emit_main_func,
+                                      int signum,
+                                      gconstpointer params,
+                                      gsize params_size,
+                                      GSignalCoalesceFunc coalesce,
+                                      GDestroyNotify free_params,
+                                      const char *debug_info)
+{
+    struct signal_queue *queue = g_object_get_qdata(object, signal_queue_quark());
+    struct signal_event event, *last;
+
+    if (queue == NULL) {
+        queue = g_new0(struct signal_queue, 1);
+        queue->object = object;
+        queue->events = g_array_new(FALSE, FALSE, sizeof(struct signal_event));
+        g_object_set_qdata_full(object, signal_queue_quark(), queue, signal_queue_free);
+    }
+
+    if (queue->events->len > 0) {
+        last = &g_array_index(queue->events, struct signal_event,
+                              queue->events->len - 1);
+        if (last->signum == signum && last->func == emit_main_func &&
+            coalesce && coalesce(signum, last->params, params)) {
+            if (free_params)
+                free_params((gpointer)params);
+            return;
+        }
+    }
+
+    event.signum = signum;
+    event.func = emit_main_func;
+    event.free_params = free_params;
+    event.params = g_memdup(params, params_size);
+    g_array_append_val(queue->events, event);
+
+    if (queue->events->len >= SIGNAL_QUEUE_MAX) {
+        /* the main context can't keep up, wait for it */
+        if (coroutine_self()->caller != NULL)
+            g_signal_emit_main_context(object, NULL, 0, NULL, debug_info);
+        else
+            signal_queue_flush(object);
+        return;
+    }
+
+    if (queue->idle_id == 0) {
+        g_object_ref(object);
+        queue->idle_id = g_idle_add(signal_queue_idle, queue);
+    }
+}
+
 static gboolean notify_main_context(gpointer opaque)
 {
     struct signal_data *signal = opaque;
 
+    signal_queue_flush(signal->object);
     g_object_notify(signal->object, signal->params);
     coroutine_yieldto(signal->caller, NULL);
 
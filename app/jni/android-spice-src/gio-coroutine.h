@@ -52,6 +52,7 @@ struct g_condition_wait_source
 };
 
 typedef void (*GSignalEmitMainFunc)(GObject *object, int signum, gpointer params);
+typedef gboolean (*GSignalCoalesceFunc)(int signum, gpointer queued, gconstpointer params);
 
 GIOCondition g_io_wait              (GSocket *sock, GIOCondition cond);
 gboolean     g_condition_wait       (g_condition_wait_func func, gpointer data);
@@ -59,6 +60,10 @@ void         g_io_wakeup            (struct wait_queue *wait);
 GIOCondition g_io_wait_interruptable(struct wait_queue *wait, GSocket *sock, GIOCondition cond);
 void         g_signal_emit_main_context(GObject *object, GSignalEmitMainFunc func,
                                         int signum, gpointer params, const char *debug_info);
+void         g_signal_emit_main_context_async(GObject *object, GSignalEmitMainFunc func,
+                                              int signum, gconstpointer params, gsize params_size,
+                                              GSignalCoalesceFunc coalesce, GDestroyNotify free_params,
+                                              const char *debug_info);
 void         g_object_notify_main_context(GObject *object, const gchar *property_name);
 
 G_END_DECLS
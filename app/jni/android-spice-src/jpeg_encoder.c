@@ -1,4 +1,12 @@
 #include "jpeg_encoder.h"
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/* scanlines converted and written to libjpeg at once, one MCU row at 4:2:0 */
+#define JPEG_BATCH_LINES 16
 
 static int jpeg_usr_more_space(int size,uint8_t **io_ptr)
 {
@@ -68,6 +76,7 @@ JpegEncoder* jpeg_encoder_create()
 void jpeg_encoder_destroy(JpegEncoder* encoder)
 {    
     jpeg_destroy_compress(&(encoder->cinfo));
+    free(encoder->RGB24_lines);
     free(encoder);
 }
 
@@ -75,7 +84,7 @@ void convert_BGRX32_to_RGB24(uint8_t *line, int width, uint8_t **out_line)
 {
     uint32_t *src_line = (uint32_t *)line;
     uint8_t *out_pix;
-    int x;
+    int x = 0;
 
     if(!(out_line && *out_line))
     {
@@ -85,7 +94,36 @@ void convert_BGRX32_to_RGB24(uint8_t *line, int width, uint8_t **out_line)
 
     out_pix = *out_line;
 
-    for (x = 0; x < width; x++) {
+#if defined(__ARM_NEON__)
+    for (; x + 16 <= width; x += 16) {
+	uint8x16x4_t bgrx = vld4q_u8((uint8_t *)src_line);
+	uint8x16x3_t rgb;
+
+	rgb.val[0] = bgrx.val[2];
+	rgb.val[1] = bgrx.val[1];
+	rgb.val[2] = bgrx.val[0];
+	vst3q_u8(out_pix, rgb);
+	src_line += 16;
+	out_pix += 48;
+    }
+#elif defined(__SSSE3__)
+    {
+	/* 4 BGRX pixels -> 12 RGB bytes, the last 4 bytes are scratch */
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+					      14, 13, 12, -1, -1, -1, -1);
+
+	/* each store writes 16 bytes for 12 useful ones: stop 1 group early */
+	for (; x + 8 <= width; x += 4) {
+	    __m128i bgrx = _mm_loadu_si128((__m128i *)src_line);
+
+	    _mm_storeu_si128((__m128i *)out_pix, _mm_shuffle_epi8(bgrx, shuffle));
+	    src_line += 4;
+	    out_pix += 12;
+	}
+    }
+#endif
+
+    for (; x < width; x++) {
 	uint32_t pixel = *src_line++;
 	*out_pix++ = (pixel >> 16) & 0xff;
 	*out_pix++ = (pixel >> 8) & 0xff;
@@ -96,24 +134,28 @@ void convert_BGRX32_to_RGB24(uint8_t *line, int width, uint8_t **out_line)
 
 static void do_jpeg_encode(JpegEncoder *jpeg, uint8_t *lines)
 {    
+    JSAMPROW row_pointer[JPEG_BATCH_LINES];
     uint8_t *RGB24_line;
-    int stride, width, height;
-    JSAMPROW row_pointer[1];
+    int stride, width, height, n, i;
     width = jpeg->cur_image.width;
     height = jpeg->cur_image.height;
     stride = jpeg->cur_image.stride;
 
-    RGB24_line = (uint8_t *)spice_malloc(width*3);
-
+    if (jpeg->RGB24_lines_size < width * 3 * JPEG_BATCH_LINES) {
+	free(jpeg->RGB24_lines);
+	jpeg->RGB24_lines_size = width * 3 * JPEG_BATCH_LINES;
+	jpeg->RGB24_lines = (uint8_t *)spice_malloc(jpeg->RGB24_lines_size);
+    }
 
-    for (;jpeg->cinfo.next_scanline < jpeg->cinfo.image_height; lines += stride) {
-	//lines+=stride to move to next line??
-	jpeg->convert_line_to_RGB24(lines, width, &RGB24_line);
-	row_pointer[0] = RGB24_line;
-	jpeg_write_scanlines(&jpeg->cinfo, row_pointer, 1);
+    while (jpeg->cinfo.next_scanline < jpeg->cinfo.image_height) {
+	n = MIN(JPEG_BATCH_LINES, height - jpeg->cinfo.next_scanline);
+	for (i = 0; i < n; i++, lines += stride) {
+	    RGB24_line = jpeg->RGB24_lines + i * width * 3;
+	    jpeg->convert_line_to_RGB24(lines, width, &RGB24_line);
+	    row_pointer[i] = RGB24_line;
+	}
+	jpeg_write_scanlines(&jpeg->cinfo, row_pointer, n);
     }
-    //can I free you?
-    free(RGB24_line);
 }
 
 int jpeg_encode(JpegEncoder *jpeg, int quality, int width, int height,
@@ -19,6 +19,10 @@ typedef struct JpegEncoder {
 	int stride;
 	unsigned int out_size;
     } cur_image;
+
+    /* RGB24 scanlines handed to libjpeg, kept between images */
+    uint8_t *RGB24_lines;
+    int RGB24_lines_size;
 } JpegEncoder;
 
 JpegEncoder* jpeg_encoder_create();
@@ -204,6 +204,121 @@ SpiceChunks *spice_chunks_new_linear(uint8_t *data, uint32_t len)
     return chunks;
 }
 
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_MAX_BLOCK (8 * 1024)
+
+typedef struct SpiceArenaChunk {
+    int refs; /* blocks allocated from it, plus one while it's the current chunk */
+    size_t used;
+} SpiceArenaChunk;
+
+#define ARENA_CHUNK_HEADER SPICE_ALIGN(sizeof(SpiceArenaChunk), 16)
+
+typedef union SpiceArenaBlock {
+    SpiceArenaChunk *chunk; /* NULL if malloc()ed */
+    uint64_t align;
+    double align_double;
+} SpiceArenaBlock;
+
+struct SpiceArena {
+    SpiceArenaChunk *chunk;
+};
+
+static SpiceArenaChunk *arena_chunk_new(void)
+{
+    SpiceArenaChunk *chunk = spice_malloc(ARENA_CHUNK_HEADER + ARENA_CHUNK_SIZE);
+
+    chunk->refs = 1;
+    chunk->used = 0;
+    return chunk;
+}
+
+SpiceArena *spice_arena_new(void)
+{
+    SpiceArena *arena = spice_new(SpiceArena, 1);
+
+    arena->chunk = arena_chunk_new();
+    return arena;
+}
+
+/* the blocks still allocated stay valid */
+void spice_arena_destroy(SpiceArena *arena)
+{
+    if (--arena->chunk->refs == 0) {
+        free(arena->chunk);
+    }
+    free(arena);
+}
+
+void *spice_arena_alloc(SpiceArena *arena, size_t n_bytes)
+{
+    SpiceArenaChunk *chunk;
+    SpiceArenaBlock *block;
+    size_t size;
+
+    if (arena == NULL || n_bytes > ARENA_MAX_BLOCK) {
+        block = spice_malloc_n_m(n_bytes, 1, sizeof(SpiceArenaBlock));
+        block->chunk = NULL;
+        return block + 1;
+    }
+
+    size = SPICE_ALIGN(sizeof(SpiceArenaBlock) + n_bytes, sizeof(SpiceArenaBlock));
+    chunk = arena->chunk;
+    if (chunk->refs == 1) {
+        chunk->used = 0;
+    } else if (chunk->used + size > ARENA_CHUNK_SIZE) {
+        chunk->refs--;
+        chunk = arena->chunk = arena_chunk_new();
+    }
+
+    block = (SpiceArenaBlock *)((uint8_t *)chunk + ARENA_CHUNK_HEADER + chunk->used);
+    block->chunk = chunk;
+    chunk->used += size;
+    chunk->refs++;
+    return block + 1;
+}
+
+void *spice_arena_alloc0(SpiceArena *arena, size_t n_bytes)
+{
+    void *mem = spice_arena_alloc(arena, n_bytes);
+
+    memset(mem, 0, n_bytes);
+    return mem;
+}
+
+void spice_arena_release(void *mem)
+{
+    SpiceArenaBlock *block;
+
+    if (mem == NULL) {
+        return;
+    }
+
+    block = (SpiceArenaBlock *)mem - 1;
+    if (block->chunk == NULL) {
+        free(block);
+    } else if (--block->chunk->refs == 0) {
+        free(block->chunk);
+    }
+}
+
+static SpiceArena *parse_arena;
+
+void spice_parse_set_arena(SpiceArena *arena)
+{
+    parse_arena = arena;
+}
+
+void *spice_parse_malloc(size_t n_bytes)
+{
+    return spice_arena_alloc(parse_arena, n_bytes);
+}
+
+void spice_parse_free(uint8_t *data)
+{
+    spice_arena_release(data);
+}
+
 void spice_chunks_destroy(SpiceChunks *chunks)
 {
     unsigned int i;
@@ -79,6 +79,28 @@ void spice_chunks_linearize(SpiceChunks *chunks);
 
 size_t spice_strnlen(const char *str, size_t max_len);
 
+/*
+ * Bump allocator for short lived blocks: the blocks of a chunk are not
+ * freed one by one, the chunk is reused from its start once they are all
+ * released. A block may outlive the others of its chunk as long as it
+ * wants: the arena moves on to a new chunk when the current one is full,
+ * and the last block released frees the old one. Large blocks, and the
+ * blocks of a NULL arena, are malloc()ed. Not thread safe.
+ */
+typedef struct SpiceArena SpiceArena;
+
+SpiceArena *spice_arena_new(void);
+void spice_arena_destroy(SpiceArena *arena);
+void *spice_arena_alloc(SpiceArena *arena, size_t n_bytes) SPICE_GNUC_MALLOC;
+void *spice_arena_alloc0(SpiceArena *arena, size_t n_bytes) SPICE_GNUC_MALLOC;
+void spice_arena_release(void *mem);
+
+/* the messages parsed by the generated demarshallers are allocated from
+ * the arena last set, if any, and released by spice_parse_free() */
+void spice_parse_set_arena(SpiceArena *arena);
+void *spice_parse_malloc(size_t n_bytes) SPICE_GNUC_MALLOC;
+void spice_parse_free(uint8_t *data);
+
 /* Optimize: avoid the call to the (slower) _n function if we can
  * determine at compile-time that no overflow happens.
  */
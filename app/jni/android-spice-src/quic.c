@@ -82,6 +82,9 @@ typedef struct QuicFamily {
                                                     determine if the codeword is GR or not-GR */
     unsigned int notGRsuffixlen[MAXNUMCODES];    /* indexed by code number, contains suffix
                                                     length of the not-GR codeword */
+    uint16_t decode_lut[MAXNUMCODES][256];       /* indexed by code number and the next 8 bits of
+                                                    input, contains (codeword length << 8) | value
+                                                    for codewords up to 8 bits long, 0 otherwise */
 
     /* array for translating distribution U to L for depths up to 8 bpp,
     initialized by decorelateinit() */
@@ -163,6 +166,7 @@ struct Encoder {
     unsigned int io_available_bits;
     uint32_t io_word;
     uint32_t io_next_word;
+    uint64_t io_bits;           /* decoding: io_word followed by io_available_bits more bits */
     uint32_t *io_now;
     uint32_t *io_end;
     uint32_t io_words_count;
@@ -313,9 +317,12 @@ static const BYTE lzeroes[256] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 };
 
-/* count leading zeroes */
-static unsigned int cnt_l_zeroes(const unsigned int bits)
+/* count leading zeroes, bits must not be 0 */
+static INLINE unsigned int cnt_l_zeroes(const unsigned int bits)
 {
+#ifdef __GNUC__
+    return __builtin_clz(bits);
+#else
     if (bits & 0xff800000) {
         return lzeroes[bits >> 24];
     } else if (bits & 0xffff8000) {
@@ -325,6 +332,23 @@ static unsigned int cnt_l_zeroes(const unsigned int bits)
     } else {
         return 24 + lzeroes[bits & 0x000000ff];
     }
+#endif
+}
+
+static unsigned int golomb_decoding_slow(const QuicFamily *family, const unsigned int l,
+                                         const unsigned int bits, unsigned int * const codewordlen)
+{
+    if (bits > family->notGRprefixmask[l]) { /*GR*/
+        const unsigned int zeroprefix = cnt_l_zeroes(bits);       /* leading zeroes in codeword */
+        const unsigned int cwlen = zeroprefix + 1 + l;            /* codeword length */
+        (*codewordlen) = cwlen;
+        return (zeroprefix << l) | ((bits >> (32 - cwlen)) & bppmask[l]);
+    } else { /* not-GR */
+        const unsigned int cwlen = family->notGRcwlen[l];
+        (*codewordlen) = cwlen;
+        return family->nGRcodewords[l] + ((bits) >> (32 - cwlen) &
+                                          bppmask[family->notGRsuffixlen[l]]);
+    }
 }
 
 #define QUIC_FAMILY_8BPC
@@ -368,6 +392,26 @@ static void corelate_init(QuicFamily *family, int bpc)
     }
 }
 
+/* a codeword fits in the table when any bits following the first 8 decode
+ * to the same value and length, both extremes are enough to tell */
+static void decode_lut_init(QuicFamily *family, int bpc)
+{
+    unsigned int l, b;
+
+    memset(family->decode_lut, 0, sizeof(family->decode_lut));
+    for (l = 0; l < (unsigned int)bpc; l++) {
+        for (b = 0; b < 256; b++) {
+            unsigned int len_lo, len_hi, val_lo, val_hi;
+
+            val_lo = golomb_decoding_slow(family, l, b << 24, &len_lo);
+            val_hi = golomb_decoding_slow(family, l, (b << 24) | 0x00ffffff, &len_hi);
+            if (len_lo == len_hi && val_lo == val_hi && len_lo <= 8 && val_lo <= 0xff) {
+                family->decode_lut[l][b] = (len_lo << 8) | val_lo;
+            }
+        }
+    }
+}
+
 static void family_init(QuicFamily *family, int bpc, int limit)
 {
     int l;
@@ -390,6 +434,7 @@ static void family_init(QuicFamily *family, int bpc, int limit)
 
     decorelate_init(family, bpc);
     corelate_init(family, bpc);
+    decode_lut_init(family, bpc);
 }
 
 static void more_io_words(Encoder *encoder)
@@ -458,6 +503,10 @@ static INLINE void flush(Encoder *encoder)
     encode(encoder, 0, 1);
 }
 
+#ifdef __GNUC__
+static void __read_io_word(Encoder *encoder) __attribute__((noinline));
+#endif
+
 static void __read_io_word(Encoder *encoder)
 {
     more_io_words(encoder);
@@ -472,13 +521,16 @@ static void __read_io_word(Encoder *encoder)
 #endif
 }
 
-static void (*__read_io_word_ptr)(Encoder *encoder) = __read_io_word;
-
+#ifdef __GNUC__
+#define UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define UNLIKELY(x) (x)
+#endif
 
 static INLINE void read_io_word(Encoder *encoder)
 {
-    if (encoder->io_now == encoder->io_end) {
-        __read_io_word_ptr(encoder); //disable inline optimizations
+    if (UNLIKELY(encoder->io_now == encoder->io_end)) {
+        __read_io_word(encoder);
         return;
     }
     ASSERT(encoder->usr, encoder->io_now < encoder->io_end);
@@ -489,24 +541,20 @@ static INLINE void read_io_word(Encoder *encoder)
 #endif
 }
 
+/* the input is buffered msb first in io_bits, a word is appended as soon as
+ * fewer than 32 bits are left, so io_word always holds the next 32 bits */
 static INLINE void decode_eatbits(Encoder *encoder, int len)
 {
-    int delta;
-
     ASSERT(encoder->usr, len > 0 && len < 32);
-    encoder->io_word <<= len;
+    encoder->io_bits <<= len;
 
-    if ((delta = ((int)encoder->io_available_bits - len)) >= 0) {
-        encoder->io_available_bits = delta;
-        encoder->io_word |= encoder->io_next_word >> encoder->io_available_bits;
-        return;
+    if ((unsigned int)len > encoder->io_available_bits) {
+        read_io_word(encoder);
+        encoder->io_bits |= (uint64_t)encoder->io_next_word << (len - encoder->io_available_bits);
+        encoder->io_available_bits += 32;
     }
-
-    delta = -delta;
-    encoder->io_word |= encoder->io_next_word << delta;
-    read_io_word(encoder);
-    encoder->io_available_bits = 32 - delta;
-    encoder->io_word |= (encoder->io_next_word >> encoder->io_available_bits);
+    encoder->io_available_bits -= len;
+    encoder->io_word = (uint32_t)(encoder->io_bits >> 32);
 }
 
 static INLINE void decode_eat32bits(Encoder *encoder)
@@ -541,6 +589,16 @@ static int J[MELCSTATES] = {
     7, 8, 9, 10, 11, 12, 13, 14, 15
 };
 
+/* number of leading ones in the top byte of word */
+static INLINE int count_l_ones_8(uint32_t word)
+{
+#ifdef __GNUC__
+    return __builtin_clz(~word | (1U << 23));
+#else
+    return zeroLUT[(BYTE)(~(word >> 24))];
+#endif
+}
+
 /* creates the bit counting look-up table. */
 static void init_zeroLUT()
 {
@@ -639,8 +697,8 @@ static int decode_run(Encoder *encoder)
 
     do {
         register int temp, hits;
-        temp = zeroLUT[(BYTE)(~(encoder->io_word >> 24))];/* number of leading ones in the
-                                                                      input stream, up to 8 */
+        temp = count_l_ones_8(encoder->io_word);/* number of leading ones in the
+                                                   input stream, up to 8 */
         for (hits = 1; hits <= temp; hits++) {
             runlen += encoder->rgb_state.melcorder;
 
@@ -680,8 +738,8 @@ static int decode_channel_run(Encoder *encoder, Channel *channel)
 
     do {
         register int temp, hits;
-        temp = zeroLUT[(BYTE)(~(encoder->io_word >> 24))];/* number of leading ones in the
-                                                                      input stream, up to 8 */
+        temp = count_l_ones_8(encoder->io_word);/* number of leading ones in the
+                                                   input stream, up to 8 */
         for (hits = 1; hits <= temp; hits++) {
             runlen += channel->state.melcorder;
 
@@ -777,6 +835,7 @@ static INLINE void init_decode_io(Encoder *encoder)
 #else
     encoder->io_next_word = encoder->io_word = *(encoder->io_now++);
 #endif
+    encoder->io_bits = (uint64_t)encoder->io_word << 32;
     encoder->io_available_bits = 0;
 }
 
@@ -23,36 +23,68 @@
 
 G_BEGIN_DECLS
 
+/*
+ * Items are found through an open addressed table of (id, item) slots,
+ * probed linearly and kept at most half full, so that a lookup usually
+ * touches a single cache line. Items are carved out of slabs and never
+ * move; free ones are chained through lru_link.
+ */
+
+#define DISPLAY_CACHE_SLAB_ITEMS 256
+#define DISPLAY_CACHE_MIN_SLOTS  256 /* power of 2 */
+
 typedef struct display_cache_item {
-    RingItem                    hash_link;
     RingItem                    lru_link;
     uint64_t                    id;
     uint32_t                    refcount;
     void                        *ptr;
+    size_t                      size; /* bytes accounted for ptr */
     gboolean                    lossy;
 } display_cache_item;
 
+typedef struct display_cache_slot {
+    uint64_t                    id;
+    display_cache_item          *item; /* NULL if free */
+} display_cache_slot;
+
+typedef struct display_cache_slab {
+    struct display_cache_slab   *next;
+    display_cache_item          items[DISPLAY_CACHE_SLAB_ITEMS];
+} display_cache_slab;
+
 typedef struct display_cache {
     const char                  *name;
-    Ring                        hash[64];
+    display_cache_slot          *slots;
+    uint32_t                    mask; /* number of slots - 1 */
     Ring                        lru;
     int                         nitems;
+    size_t                      bytes;
+    size_t                      budget; /* asked of the server, not enforced here */
+
+    display_cache_slab          *slabs;
+    RingItem                    *free_items;
+
+    /* lookups through cache_find() */
+    uint64_t                    hits;
+    uint64_t                    misses;
+    /* the server manages the cache: items it invalidated, and those
+     * actually released once no longer referenced */
+    uint64_t                    evictions;
+    uint64_t                    invalidations;
 } display_cache;
 
 static inline void cache_init(display_cache *cache, const char *name)
 {
-    int i;
-
+    memset(cache, 0, sizeof(*cache));
     cache->name = name;
     ring_init(&cache->lru);
-    for (i = 0; i < SPICE_N_ELEMENTS(cache->hash); i++) {
-        ring_init(&cache->hash[i]);
-    }
 }
 
-static inline Ring *cache_head(display_cache *cache, uint64_t id)
+static inline uint32_t cache_hash(display_cache *cache, uint64_t id)
 {
-    return &cache->hash[id % SPICE_N_ELEMENTS(cache->hash)];
+    /* ids are often sequential or share their high bits: mix them */
+    id *= 0x9e3779b97f4a7c15ULL;
+    return (uint32_t)(id >> 32) & cache->mask;
 }
 
 static inline void cache_used(display_cache *cache, display_cache_item *item)
@@ -73,49 +105,166 @@ static inline display_cache_item *cache_get_lru(display_cache *cache)
     return item;
 }
 
+/* like cache_find(), without counting a hit or a miss */
+static inline display_cache_item *cache_lookup(display_cache *cache, uint64_t id)
+{
+    uint32_t i;
+
+    if (cache->slots == NULL)
+        return NULL;
+
+    for (i = cache_hash(cache, id); cache->slots[i].item != NULL;
+         i = (i + 1) & cache->mask) {
+        if (cache->slots[i].id == id)
+            return cache->slots[i].item;
+    }
+    return NULL;
+}
+
 static inline display_cache_item *cache_find(display_cache *cache, uint64_t id)
 {
-    display_cache_item *item;
-    RingItem *ring;
-    Ring *head;
+    display_cache_item *item = cache_lookup(cache, id);
 
-    head = cache_head(cache, id);
-    for (ring = ring_get_head(head); ring != NULL; ring = ring_next(head, ring)) {
-        item = SPICE_CONTAINEROF(ring, display_cache_item, hash_link);
-        if (item->id == id) {
-            return item;
-        }
+    if (item) {
+        cache->hits++;
+        return item;
     }
 
-    SPICE_DEBUG("%s: %s %" PRIx64 " [not found]", __FUNCTION__,
-            cache->name, id);
+    cache->misses++;
+    SPICE_TRACE(CACHE_MISS, SPICE_TRACE_PTR(cache->name), id);
     return NULL;
 }
 
+static inline void cache_insert_slot(display_cache *cache, display_cache_item *item)
+{
+    uint32_t i;
+
+    for (i = cache_hash(cache, item->id); cache->slots[i].item != NULL;
+         i = (i + 1) & cache->mask)
+        ;
+    cache->slots[i].id = item->id;
+    cache->slots[i].item = item;
+}
+
+static inline void cache_grow(display_cache *cache)
+{
+    display_cache_slot *old = cache->slots;
+    uint32_t i, nslots = old ? (cache->mask + 1) * 2 : DISPLAY_CACHE_MIN_SLOTS;
+
+    cache->slots = spice_new0(display_cache_slot, nslots);
+    cache->mask = nslots - 1;
+    if (old == NULL)
+        return;
+    for (i = 0; i < nslots / 2; i++) {
+        if (old[i].item != NULL)
+            cache_insert_slot(cache, old[i].item);
+    }
+    free(old);
+}
+
+static inline display_cache_item *cache_alloc_item(display_cache *cache)
+{
+    display_cache_slab *slab;
+    RingItem *ring;
+    int i;
+
+    if (cache->free_items == NULL) {
+        slab = spice_new(display_cache_slab, 1);
+        slab->next = cache->slabs;
+        cache->slabs = slab;
+        for (i = 0; i < DISPLAY_CACHE_SLAB_ITEMS; i++) {
+            slab->items[i].lru_link.next = cache->free_items;
+            cache->free_items = &slab->items[i].lru_link;
+        }
+    }
+    ring = cache->free_items;
+    cache->free_items = ring->next;
+    return SPICE_CONTAINEROF(ring, display_cache_item, lru_link);
+}
+
 static inline display_cache_item *cache_add(display_cache *cache, uint64_t id)
 {
     display_cache_item *item;
 
-    item = spice_new0(display_cache_item, 1);
+    if (cache->slots == NULL || (cache->nitems + 1) * 2 > cache->mask + 1)
+        cache_grow(cache);
+
+    item = cache_alloc_item(cache);
+    memset(item, 0, sizeof(*item));
     item->id = id;
     item->refcount = 1;
-    ring_add(cache_head(cache, item->id), &item->hash_link);
+    cache_insert_slot(cache, item);
     ring_add(&cache->lru, &item->lru_link);
     cache->nitems++;
 
-    SPICE_DEBUG("%s: %s %" PRIx64 " (%d)", __FUNCTION__,
-            cache->name, id, cache->nitems);
+    SPICE_TRACE(CACHE_ADD, SPICE_TRACE_PTR(cache->name), id, cache->nitems);
     return item;
 }
 
+/* accounts @size bytes for the item, instead of what it had before */
+static inline void cache_set_size(display_cache *cache, display_cache_item *item,
+                                  size_t size)
+{
+    cache->bytes -= item->size;
+    cache->bytes += size;
+    item->size = size;
+}
+
 static inline void cache_del(display_cache *cache, display_cache_item *item)
 {
-    SPICE_DEBUG("%s: %s %" PRIx64, __FUNCTION__,
-            cache->name, item->id);
-    ring_remove(&item->hash_link);
+    uint32_t i, j, k;
+
+    SPICE_TRACE(CACHE_DEL, SPICE_TRACE_PTR(cache->name), item->id);
+
+    for (i = cache_hash(cache, item->id); cache->slots[i].item != item;
+         i = (i + 1) & cache->mask)
+        ;
+    /* shift back the following items of the cluster that may not stay
+     * after the hole, as no tombstone marks it */
+    for (j = (i + 1) & cache->mask; cache->slots[j].item != NULL;
+         j = (j + 1) & cache->mask) {
+        k = cache_hash(cache, cache->slots[j].id);
+        if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+            cache->slots[i] = cache->slots[j];
+            i = j;
+        }
+    }
+    cache->slots[i].item = NULL;
+
     ring_remove(&item->lru_link);
-    free(item);
+    cache->bytes -= item->size;
     cache->nitems--;
+    item->lru_link.next = cache->free_items;
+    cache->free_items = &item->lru_link;
+}
+
+/* releases the memory of the cache itself, its items must be gone */
+static inline void cache_destroy(display_cache *cache)
+{
+    display_cache_slab *slab;
+
+    g_warn_if_fail(cache->nitems == 0);
+    while (cache->slabs) {
+        slab = cache->slabs;
+        cache->slabs = slab->next;
+        free(slab);
+    }
+    free(cache->slots);
+    cache->slots = NULL;
+    cache->free_items = NULL;
+}
+
+static inline void cache_log_stats(display_cache *cache)
+{
+    uint64_t lookups = cache->hits + cache->misses;
+
+    SPICE_DEBUG("%s cache: %d items, %" G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT " bytes, "
+                "%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " hits (%d%%), "
+                "%" G_GUINT64_FORMAT " released, %" G_GUINT64_FORMAT " invalidated",
+                cache->name, cache->nitems, cache->bytes, cache->budget,
+                cache->hits, lookups,
+                lookups ? (int)(cache->hits * 100 / lookups) : 0,
+                cache->evictions, cache->invalidations);
 }
 
 static inline void cache_ref(display_cache_item *item)
@@ -20,6 +20,7 @@
 
 #include <openssl/ssl.h>
 #include <gio/gio.h>
+#include <time.h>
 
 #include "coroutine.h"
 #include "gio-coroutine.h"
@@ -48,9 +49,13 @@ struct spice_msg_in {
     uint8_t               *parsed;
     size_t                psize;
     message_destructor_t  pfree;
+    gboolean              parse_pending; /* see spice_channel_set_lazy_parse() */
     spice_msg_in          *parent;
 };
 
+/* reads smaller than half of it are buffered, see spice_channel_read() */
+#define SPICE_CHANNEL_RECV_BUFFER_SIZE (64 * 1024)
+
 enum spice_channel_state {
     SPICE_CHANNEL_STATE_UNCONNECTED = 0,
     SPICE_CHANNEL_STATE_CONNECTING,
@@ -68,6 +73,9 @@ struct spice_channel {
     SSL                         *ssl;
     SpiceOpenSSLVerify          *sslverify;
     GSocket                     *sock;
+    guint8                      *recv_buffer; /* read ahead of sock */
+    int                         recv_buffer_pos;
+    int                         recv_buffer_len;
 
     /* not swapped */
     SpiceSession                *session;
@@ -78,11 +86,10 @@ struct spice_channel {
 
     int                         wait_interruptable;
     struct wait_queue           wait;
-    guint8                      *xmit_buffer;
-    int                         xmit_buffer_capacity;
-    int                         xmit_buffer_size;
+    GQueue                      xmit_queue; /* spice_msg_out, see spice_msg_out_queue() */
 
     char                        name[16];
+    const gchar                 *trace_name; /* interned name, for SPICE_TRACE */
     enum spice_channel_state    state;
     spice_parse_channel_func_t  parser;
     SpiceMessageMarshallers     *marshallers;
@@ -100,9 +107,16 @@ struct spice_channel {
     int                         peer_pos;
 
     spice_msg_in                *msg_in;
+    SpiceArena                  *msg_arena; /* msg_in, their body and parsed message */
+    guint8                      *lazy_parse; /* indexed by message type */
+    guint                       lazy_parse_size;
     int                         message_ack_window;
     int                         message_ack_count;
 
+    SpiceMsgStats               *msg_stats; /* indexed by message type */
+    guint                       msg_stats_size;
+    guint64                     msg_stats_deferred_ns; /* see spice_channel_msg_stats_add_deferred() */
+
     GArray                      *caps;
     GArray                      *common_caps;
     GArray                      *remote_caps;
@@ -124,6 +138,7 @@ void spice_msg_out_ref(spice_msg_out *out);
 void spice_msg_out_unref(spice_msg_out *out);
 void spice_msg_out_send(spice_msg_out *out);
 void spice_msg_out_send_internal(spice_msg_out *out);
+void spice_msg_out_queue(spice_msg_out *out);
 void spice_msg_out_hexdump(spice_msg_out *out, unsigned char *data, int len);
 
 void spice_channel_up(SpiceChannel *channel);
@@ -134,6 +149,16 @@ SpiceSession* spice_channel_get_session(SpiceChannel *channel);
 /* coroutine context */
 typedef void (*handler_msg_in)(SpiceChannel *channel, spice_msg_in *msg, gpointer data);
 void spice_channel_recv_msg(SpiceChannel *channel, handler_msg_in handler, gpointer data);
+void spice_channel_msg_stats_add_deferred(SpiceChannel *channel, spice_msg_in *in, guint64 ns);
+void spice_channel_set_lazy_parse(SpiceChannel *channel, int type);
+
+static inline guint64 spice_channel_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
 
 /* channel-base.c */
 /* coroutine context */
@@ -155,6 +180,16 @@ void spice_channel_swap(SpiceChannel *channel, SpiceChannel *swap);
                                    event, &((struct event) { args }), G_STRLOC); \
     } G_STMT_END
 
+/* coroutine context, doesn't wait for the signal to be emitted: for
+ * frequent signals, see g_signal_emit_main_context_async() */
+#define emit_main_context_async(object, coalesce, free_params, event, args...) \
+    G_STMT_START {                                                      \
+        g_signal_emit_main_context_async(G_OBJECT(object), do_emit_main_context, \
+                                         event, &((struct event) { args }), \
+                                         sizeof(struct event), coalesce, \
+                                         free_params, G_STRLOC);        \
+    } G_STMT_END
+
 
 G_END_DECLS
 
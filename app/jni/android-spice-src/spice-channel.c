@@ -39,12 +39,18 @@
 #include <arpa/inet.h>
 #endif
 #include <ctype.h>
+#include <limits.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 
 #include "gio-coroutine.h"
 
 static void spice_channel_send_msg(SpiceChannel *channel, spice_msg_out *out, gboolean buffered);
 static void spice_channel_send_link(SpiceChannel *channel);
 static void channel_disconnect(SpiceChannel *channel);
+static gboolean msg_in_parse(spice_channel *c, spice_msg_in *in);
 
 /**
  * SECTION:spice-channel
@@ -108,10 +114,12 @@ static void spice_channel_init(SpiceChannel *channel)
     c->serial = 1;
     c->fd = -1;
     strcpy(c->name, "?");
+    c->trace_name = g_intern_static_string("?");
     c->caps = g_array_new(FALSE, TRUE, sizeof(guint32));
     c->common_caps = g_array_new(FALSE, TRUE, sizeof(guint32));
     c->remote_caps = g_array_new(FALSE, TRUE, sizeof(guint32));
     c->remote_common_caps = g_array_new(FALSE, TRUE, sizeof(guint32));
+    c->msg_arena = spice_arena_new();
 }
 
 static void spice_channel_constructed(GObject *gobject)
@@ -125,6 +133,8 @@ static void spice_channel_constructed(GObject *gobject)
 
     snprintf(c->name, sizeof(c->name), "%s-%d:%d",
              desc ? desc : "unknown", c->channel_type, c->channel_id);
+    /* the trace records outlive the channel, their names must too */
+    c->trace_name = g_intern_string(c->name);
     SPICE_DEBUG("%s: %s", c->name, __FUNCTION__);
 
     c->connection_id = spice_session_get_connection_id(c->session);
@@ -176,6 +186,10 @@ static void spice_channel_finalize(GObject *gobject)
     if (c->remote_common_caps)
         g_array_free(c->remote_common_caps, TRUE);
 
+    g_free(c->msg_stats);
+    g_free(c->lazy_parse);
+    spice_arena_destroy(c->msg_arena);
+
     /* Chain up to the parent class */
     if (G_OBJECT_CLASS(spice_channel_parent_class)->finalize)
         G_OBJECT_CLASS(spice_channel_parent_class)->finalize(gobject);
@@ -352,7 +366,9 @@ spice_msg_in *spice_msg_in_new(SpiceChannel *channel)
 
     g_return_val_if_fail(channel != NULL, NULL);
 
-    in = spice_new0(spice_msg_in, 1);
+    /* the arena only gets reused once the messages are released: those
+     * kept for later (stream frames, pipelined draws...) don't prevent it */
+    in = spice_arena_alloc0(channel->priv->msg_arena, sizeof(spice_msg_in));
     in->refcount = 1;
     in->channel  = channel;
     return in;
@@ -397,9 +413,9 @@ void spice_msg_in_unref(spice_msg_in *in)
     if (in->parent) {
         spice_msg_in_unref(in->parent);
     } else {
-        free(in->data);
+        spice_arena_release(in->data);
     }
-    free(in);
+    spice_arena_release(in);
 }
 
 G_GNUC_INTERNAL
@@ -415,6 +431,14 @@ void *spice_msg_in_parsed(spice_msg_in *in)
 {
     g_return_val_if_fail(in != NULL, NULL);
 
+    if (G_UNLIKELY(in->parse_pending)) {
+        spice_channel *c = in->channel->priv;
+        guint64 start = spice_channel_now_ns();
+
+        msg_in_parse(c, in);
+        /* accounted as parse time, not to the handler running */
+        c->msg_stats_deferred_ns += spice_channel_now_ns() - start;
+    }
     return in->parsed;
 }
 
@@ -535,6 +559,18 @@ void spice_msg_out_send_internal(spice_msg_out *out)
     spice_channel_send_msg(out->channel, out, FALSE);
 }
 
+/* coroutine context: the message is written along with the next one
+ * sent, or before the coroutine reads the next message */
+G_GNUC_INTERNAL
+void spice_msg_out_queue(spice_msg_out *out)
+{
+    g_return_if_fail(out != NULL);
+
+    out->header->size =
+        spice_marshaller_get_total_size(out->marshaller) - sizeof(SpiceDataHeader);
+    spice_channel_send_msg(out->channel, out, TRUE);
+}
+
 /* ---------------------------------------------------------------- */
 
 struct SPICE_CHANNEL_EVENT {
@@ -558,28 +594,54 @@ static void do_emit_main_context(GObject *object, int signum, gpointer params)
     }
 }
 
+/* copies the first 'size' bytes of 'vec' at most */
+static size_t iovec_gather(guint8 *buf, size_t size, const struct iovec *vec, int n_vec)
+{
+    size_t len = 0, n;
+
+    for (; n_vec > 0 && len < size; vec++, n_vec--) {
+        n = MIN(vec->iov_len, size - len);
+        memcpy(buf + len, vec->iov_base, n);
+        len += n;
+    }
+    return len;
+}
+
 /*
- * Write all 'data' of length 'datalen' bytes out to
- * the wire
+ * Write all the 'n_vec' buffers of 'vec' out to the wire, 'vec' is
+ * modified in the process.
+ *
+ * SSL has no writev(): the smaller buffers are gathered into a record of
+ * the maximum size, the larger ones are written in place.
  */
 /* coroutine context */
 static void spice_channel_flush_wire(SpiceChannel *channel,
-                                     const void *data,
-                                     size_t datalen)
+                                     struct iovec *vec, int n_vec)
 {
     spice_channel *c = channel->priv;
-    const char *ptr = data;
-    size_t offset = 0;
+    guint8 record[SSL3_RT_MAX_PLAIN_LENGTH];
     GIOCondition cond;
 
-    while (offset < datalen) {
+    while (n_vec > 0) {
         int ret;
 
         if (c->has_error) return;
 
+        if (vec->iov_len == 0) {
+            vec++;
+            n_vec--;
+            continue;
+        }
+
         cond = 0;
         if (c->tls) {
-            ret = SSL_write(c->ssl, ptr+offset, datalen-offset);
+            /* when retried, the same bytes are gathered again at the same
+               address, as SSL_write() wants */
+            if (vec->iov_len >= sizeof(record))
+                ret = SSL_write(c->ssl, vec->iov_base, vec->iov_len);
+            else
+                ret = SSL_write(c->ssl, record,
+                                iovec_gather(record, sizeof(record), vec, n_vec));
             if (ret < 0) {
                 ret = SSL_get_error(c->ssl, ret);
                 if (ret == SSL_ERROR_WANT_READ)
@@ -589,23 +651,26 @@ static void spice_channel_flush_wire(SpiceChannel *channel,
                 ret = -1;
             }
         } else {
-            GError *error = NULL;
-            ret = g_socket_send(c->sock, ptr+offset, datalen-offset,
-                                NULL, &error);
+            struct msghdr msg = { 0, };
+
+            msg.msg_iov = vec;
+            msg.msg_iovlen = MIN(n_vec, IOV_MAX);
+            ret = sendmsg(g_socket_get_fd(c->sock), &msg, MSG_NOSIGNAL);
             if (ret < 0) {
-                if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
                     cond = G_IO_OUT;
+                } else if (errno == EINTR) {
+                    continue;
                 } else {
-                    SPICE_DEBUG("Send error %s", error->message);
+                    SPICE_DEBUG("Send error %s", strerror(errno));
 		    exit(1);
                 }
-                g_clear_error(&error);
                 ret = -1;
             }
         }
         if (ret == -1) {
             if (cond != 0) {
-		SPICE_DEBUG("g_io_waiting");
+                SPICE_TRACE(CHANNEL_WAIT, SPICE_TRACE_PTR(c->trace_name), cond);
                 g_io_wait(c->sock, cond);
             } else {
                 SPICE_DEBUG("Closing the channel: spice_channel_flush %d", errno);
@@ -618,14 +683,67 @@ static void spice_channel_flush_wire(SpiceChannel *channel,
             c->has_error = TRUE;
             return;
         }
-        offset += ret;
+        while (ret > 0) {
+            if ((size_t)ret < vec->iov_len) {
+                vec->iov_base = (guint8 *)vec->iov_base + ret;
+                vec->iov_len -= ret;
+                break;
+            }
+            ret -= vec->iov_len;
+            vec++;
+            n_vec--;
+        }
     }
 }
 
 /* coroutine context */
 static void spice_channel_write(SpiceChannel *channel, const void *data, size_t len)
 {
-    spice_channel_flush_wire(channel, data, len);
+    struct iovec vec = { (void *)data, len };
+
+    spice_channel_flush_wire(channel, &vec, 1);
+}
+
+/*
+ * Write the queued messages, then 'out' if not NULL, straight from their
+ * marshallers: a single sendmsg() call for all of them when the socket
+ * takes it.
+ */
+/* coroutine context */
+static void spice_channel_write_msgs(SpiceChannel *channel, spice_msg_out *out)
+{
+    spice_channel *c = channel->priv;
+    struct iovec stack_vec[32], *vec = stack_vec;
+    int size = G_N_ELEMENTS(stack_vec), n_vec = 0, n;
+    GQueue msgs = c->xmit_queue;
+    GList *l;
+
+    /* the queue may grow again while the coroutine waits for the socket */
+    g_queue_init(&c->xmit_queue);
+    if (out != NULL) {
+        spice_msg_out_ref(out);
+        g_queue_push_tail(&msgs, out);
+    }
+
+    for (l = msgs.head; l != NULL; l = l->next) {
+        out = l->data;
+        /* when it fills the rest of vec, there may be more */
+        while ((n = spice_marshaller_fill_iovec(out->marshaller, vec + n_vec,
+                                                size - n_vec, 0)) == size - n_vec) {
+            size *= 2;
+            if (vec == stack_vec)
+                vec = g_memdup(stack_vec, sizeof(stack_vec));
+            vec = g_renew(struct iovec, vec, size);
+        }
+        n_vec += n;
+    }
+
+    spice_channel_flush_wire(channel, vec, n_vec);
+
+    if (vec != stack_vec)
+        g_free(vec);
+    while ((out = g_queue_pop_head(&msgs)) != NULL)
+        spice_msg_out_unref(out);
 }
 
 /*
@@ -670,6 +788,8 @@ reread:
 
     if (ret == -1) {
         if (cond != 0) {
+            if (SPICE_CHANNEL_GET_CLASS(channel)->read_idle)
+                SPICE_CHANNEL_GET_CLASS(channel)->read_idle(channel);
             if (c->wait_interruptable) {
                 if (!g_io_wait_interruptable(&c->wait, c->sock, cond)) {
                     // SPICE_DEBUG("Read blocking interrupted %d", priv->has_error);
@@ -695,6 +815,10 @@ reread:
 
 /*
  * Fill the 'data' buffer up with exactly 'len' bytes worth of data
+ *
+ * Small reads are served from recv_buffer, refilled with as much as the
+ * wire has at once, so that a burst of small messages costs one read
+ * rather than two per message. Large reads go straight into 'data'.
  */
 /* coroutine context */
 static int spice_channel_read(SpiceChannel *channel, void *data, size_t length)
@@ -706,9 +830,25 @@ static int spice_channel_read(SpiceChannel *channel, void *data, size_t length)
     if (c->has_error) return 0; /* has_error is set by disconnect(), return no error */
 
     while (len > 0) {
-        ret = spice_channel_read_wire(channel, data, len);
-        if (ret <= 0)
-            return ret;
+        if (c->recv_buffer_pos < c->recv_buffer_len) {
+            ret = MIN(len, c->recv_buffer_len - c->recv_buffer_pos);
+            memcpy(data, c->recv_buffer + c->recv_buffer_pos, ret);
+            c->recv_buffer_pos += ret;
+        } else if (len >= SPICE_CHANNEL_RECV_BUFFER_SIZE / 2) {
+            ret = spice_channel_read_wire(channel, data, len);
+            if (ret <= 0)
+                return ret;
+        } else {
+            if (c->recv_buffer == NULL)
+                c->recv_buffer = g_malloc(SPICE_CHANNEL_RECV_BUFFER_SIZE);
+            ret = spice_channel_read_wire(channel, c->recv_buffer,
+                                          SPICE_CHANNEL_RECV_BUFFER_SIZE);
+            if (ret <= 0)
+                return ret;
+            c->recv_buffer_pos = 0;
+            c->recv_buffer_len = ret;
+            continue;
+        }
         g_assert(ret <= len);
         len -= ret;
         data = ((char*)data) + ret;
@@ -955,56 +1095,126 @@ static void spice_channel_recv_link_msg(SpiceChannel *channel)
 }
 
 /* system context */
-static void spice_channel_buffered_write(SpiceChannel *channel, const void *data, size_t size)
+/* TODO: we currently flush/wakeup immediately all buffered messages */
+G_GNUC_INTERNAL
+void spice_channel_wakeup(SpiceChannel *channel)
 {
     spice_channel *c = channel->priv;
-    size_t left;
 
-    left = c->xmit_buffer_capacity - c->xmit_buffer_size;
-    if (left < size) {
-        c->xmit_buffer_capacity += size + 4095;
-        c->xmit_buffer_capacity &= ~4095;
+    g_io_wakeup(&c->wait);
+}
+
+/* coroutine context if @buffered is TRUE,
+   system context if @buffered is FALSE: the queued messages are written
+   first, the message buffers are not copied */
+static void spice_channel_send_msg(SpiceChannel *channel, spice_msg_out *out, gboolean buffered)
+{
+    g_return_if_fail(channel != NULL);
+    g_return_if_fail(out != NULL);
 
-        c->xmit_buffer = g_realloc(c->xmit_buffer, c->xmit_buffer_capacity);
+    SPICE_TRACE(CHANNEL_SEND, SPICE_TRACE_PTR(channel->priv->trace_name),
+                out->header->type, spice_marshaller_get_total_size(out->marshaller),
+                buffered);
+    if (buffered) {
+        spice_msg_out_ref(out);
+        g_queue_push_tail(&channel->priv->xmit_queue, out);
+    } else {
+        spice_channel_write_msgs(channel, out);
     }
+}
 
-    memcpy(&c->xmit_buffer[c->xmit_buffer_size], data, size);
+static SpiceMsgStats *msg_stats_get(spice_channel *c, guint type)
+{
+    if (G_UNLIKELY(type >= c->msg_stats_size)) {
+        guint size = MAX(type + 1, c->msg_stats_size * 2);
 
-    c->xmit_buffer_size += size;
+        c->msg_stats = g_renew(SpiceMsgStats, c->msg_stats, size);
+        memset(c->msg_stats + c->msg_stats_size, 0,
+               (size - c->msg_stats_size) * sizeof(SpiceMsgStats));
+        c->msg_stats_size = size;
+    }
+    return &c->msg_stats[type];
 }
 
-/* system context */
-/* TODO: we currently flush/wakeup immediately all buffered messages */
+/* coroutine context, returns FALSE on malformed message */
+static gboolean msg_in_parse(spice_channel *c, spice_msg_in *in)
+{
+    guint64 start = spice_channel_now_ns();
+
+    in->parse_pending = FALSE;
+    spice_parse_set_arena(c->msg_arena);
+    in->parsed = c->parser(in->data, in->data + in->dpos, in->header.type,
+                           c->peer_hdr.minor_version, &in->psize, &in->pfree);
+    spice_parse_set_arena(NULL);
+    if (in->parsed == NULL) {
+        g_critical("failed to parse %smessage: %s type %d",
+                   in->parent ? "sub-" : "", c->name, in->header.type);
+        return FALSE;
+    }
+    msg_stats_get(c, in->header.type)->parse_ns += spice_channel_now_ns() - start;
+    return TRUE;
+}
+
+/* coroutine context, parses the message unless its handler does it
+ * with spice_msg_in_parsed() */
+static gboolean msg_in_received(spice_channel *c, spice_msg_in *in)
+{
+    SpiceMsgStats *stats = msg_stats_get(c, in->header.type);
+
+    stats->count++;
+    stats->bytes += in->header.size;
+    if (in->header.type < c->lazy_parse_size && c->lazy_parse[in->header.type]) {
+        in->parse_pending = TRUE;
+        return TRUE;
+    }
+    return msg_in_parse(c, in);
+}
+
+/* @deferred_ns is c->msg_stats_deferred_ns before the handler was called */
+static void msg_stats_handled(spice_channel *c, spice_msg_in *in,
+                              guint64 start, guint64 deferred_ns)
+{
+    guint64 ns = spice_channel_now_ns() - start;
+
+    /* the pipelined messages run meanwhile have accounted it already */
+    ns -= MIN(ns, c->msg_stats_deferred_ns - deferred_ns);
+    msg_stats_get(c, in->header.type)->handle_ns += ns;
+}
+
+/* coroutine context: for a message whose handler only queued some work,
+ * accounts the @ns it took once run, from another message handler or
+ * while idle */
 G_GNUC_INTERNAL
-void spice_channel_wakeup(SpiceChannel *channel)
+void spice_channel_msg_stats_add_deferred(SpiceChannel *channel, spice_msg_in *in, guint64 ns)
 {
     spice_channel *c = channel->priv;
 
-    g_io_wakeup(&c->wait);
+    msg_stats_get(c, in->header.type)->handle_ns += ns;
+    c->msg_stats_deferred_ns += ns;
 }
 
-/* coroutine context if @buffered is TRUE,
-   system context if @buffered is FALSE */
-static void spice_channel_send_msg(SpiceChannel *channel, spice_msg_out *out, gboolean buffered)
+/**
+ * spice_channel_set_lazy_parse:
+ * @channel: a #SpiceChannel
+ * @type: a message type
+ *
+ * The messages of @type are only parsed by the first call to
+ * spice_msg_in_parsed(), which returns %NULL if it fails: handlers can
+ * look at the raw message first and drop it without parsing it.
+ **/
+G_GNUC_INTERNAL
+void spice_channel_set_lazy_parse(SpiceChannel *channel, int type)
 {
-    uint8_t *data;
-    int free_data;
-    size_t len;
-    SPICE_DEBUG("spice_channel_send_msg:%d",buffered);
+    spice_channel *c = channel->priv;
 
-    g_return_if_fail(channel != NULL);
-    g_return_if_fail(out != NULL);
+    g_return_if_fail(type >= 0);
 
-    data = spice_marshaller_linearize(out->marshaller, 0,
-                                      &len, &free_data);
-    /* spice_msg_out_hexdump(out, data, len); */
-    if (buffered)
-        spice_channel_buffered_write(channel, data, len);
-    else
-        spice_channel_write(channel, data, len);
-    if (free_data) {
-        free(data);
+    if ((guint)type >= c->lazy_parse_size) {
+        c->lazy_parse = g_realloc(c->lazy_parse, type + 1);
+        memset(c->lazy_parse + c->lazy_parse_size, 0, type + 1 - c->lazy_parse_size);
+        c->lazy_parse_size = type + 1;
     }
+    c->lazy_parse[type] = TRUE;
 }
 
 /* coroutine context */
@@ -1014,6 +1224,7 @@ void spice_channel_recv_msg(SpiceChannel *channel,
 {
     spice_channel *c = channel->priv;
     spice_msg_in *in;
+    guint64 start, deferred_ns;
     int rc;
 
     if (!c->msg_in) {
@@ -1032,7 +1243,7 @@ void spice_channel_recv_msg(SpiceChannel *channel,
         in->hpos += rc;
         if (in->hpos < sizeof(in->header))
             return;
-        in->data = spice_malloc(in->header.size);
+        in->data = spice_arena_alloc(c->msg_arena, in->header.size);
     }
     if (in->dpos < in->header.size) {
         rc = spice_channel_read(channel, in->data + in->dpos,
@@ -1045,6 +1256,7 @@ void spice_channel_recv_msg(SpiceChannel *channel,
         if (in->dpos < in->header.size)
             return;
     }
+    SPICE_TRACE(CHANNEL_RECV, SPICE_TRACE_PTR(c->trace_name), in->header.type, in->header.size);
 
     if (in->header.sub_list) {
         SpiceSubMessageList *sub_list;
@@ -1056,15 +1268,12 @@ void spice_channel_recv_msg(SpiceChannel *channel,
         for (i = 0; i < sub_list->size; i++) {
             sub = (SpiceSubMessage *)(in->data + sub_list->sub_messages[i]);
             sub_in = spice_msg_in_sub_new(channel, in, sub);
-            sub_in->parsed = c->parser(sub_in->data, sub_in->data + sub_in->dpos,
-                                       sub_in->header.type, c->peer_hdr.minor_version,
-                                       &sub_in->psize, &sub_in->pfree);
-            if (sub_in->parsed == NULL) {
-                g_critical("failed to parse sub-message: %s type %d",
-                           c->name, sub_in->header.type);
+            if (!msg_in_received(c, sub_in))
                 return;
-            }
+            start = spice_channel_now_ns();
+            deferred_ns = c->msg_stats_deferred_ns;
             msg_handler(channel, sub_in, data);
+            msg_stats_handled(c, sub_in, start, deferred_ns);
             spice_msg_in_unref(sub_in);
         }
     }
@@ -1081,17 +1290,15 @@ void spice_channel_recv_msg(SpiceChannel *channel,
     }
 
     /* parse message */
-    in->parsed = c->parser(in->data, in->data + in->dpos, in->header.type,
-                           c->peer_hdr.minor_version, &in->psize, &in->pfree);
-    if (in->parsed == NULL) {
-        g_critical("failed to parse message: %s type %d",
-                   c->name, in->header.type);
+    if (!msg_in_received(c, in))
         return;
-    }
 
     /* process message */
     c->msg_in = NULL; /* the function is reentrant, reset state */
+    start = spice_channel_now_ns();
+    deferred_ns = c->msg_stats_deferred_ns;
     msg_handler(channel, in, data);
+    msg_stats_handled(c, in, start, deferred_ns);
 
     /* release message */
     spice_msg_in_unref(in);
@@ -1165,10 +1372,21 @@ static void spice_channel_iterate_write(SpiceChannel *channel)
 {
     spice_channel *c = channel->priv;
 
-    if (c->xmit_buffer_size) {
-        spice_channel_write(channel, c->xmit_buffer, c->xmit_buffer_size);
-        c->xmit_buffer_size = 0;
-    }
+    if (!g_queue_is_empty(&c->xmit_queue))
+        spice_channel_write_msgs(channel, NULL);
+}
+
+/* whether recv_buffer holds a whole message, to be handled without I/O */
+static gboolean spice_channel_has_buffered_msg(SpiceChannel *channel)
+{
+    spice_channel *c = channel->priv;
+    SpiceDataHeader header;
+    int avail = c->recv_buffer_len - c->recv_buffer_pos;
+
+    if (c->msg_in != NULL || avail < sizeof(header))
+        return FALSE;
+    memcpy(&header, c->recv_buffer + c->recv_buffer_pos, sizeof(header));
+    return avail - sizeof(header) >= header.size;
 }
 
 /* coroutine context */
@@ -1188,8 +1406,12 @@ static void spice_channel_iterate_read(SpiceChannel *channel)
         spice_channel_recv_auth(channel);
         break;
     case SPICE_CHANNEL_STATE_READY:
-        spice_channel_recv_msg(channel,
-            (handler_msg_in)SPICE_CHANNEL_GET_CLASS(channel)->handle_msg, NULL);
+        /* handle all the complete messages already read ahead */
+        do {
+            spice_channel_recv_msg(channel,
+                (handler_msg_in)SPICE_CHANNEL_GET_CLASS(channel)->handle_msg, NULL);
+        } while (c->state == SPICE_CHANNEL_STATE_READY && !c->has_error &&
+                 spice_channel_has_buffered_msg(channel));
         break;
     default:
         g_critical("unknown state %d", c->state);
@@ -1534,12 +1756,13 @@ static void channel_disconnect(SpiceChannel *channel)
     c->peer_msg = NULL;
     c->peer_pos = 0;
 
-    if (c->xmit_buffer) {
-        g_free(c->xmit_buffer);
-        c->xmit_buffer = NULL;
-        c->xmit_buffer_size = 0;
-        c->xmit_buffer_capacity = 0;
-    }
+    while (!g_queue_is_empty(&c->xmit_queue))
+        spice_msg_out_unref(g_queue_pop_head(&c->xmit_queue));
+
+    g_free(c->recv_buffer);
+    c->recv_buffer = NULL;
+    c->recv_buffer_pos = 0;
+    c->recv_buffer_len = 0;
 
     g_array_set_size(c->remote_common_caps, 0);
     g_array_set_size(c->remote_caps, 0);
@@ -1647,6 +1870,85 @@ void spice_channel_set_capability(SpiceChannel *channel, guint32 cap)
     set_capability(c->caps, cap);
 }
 
+/**
+ * spice_channel_get_msg_stats:
+ * @channel:
+ * @type: a message type
+ * @stats: filled with the counters of @type
+ *
+ * Returns: %TRUE if any message of @type was received since the channel
+ * was created or its counters reset.
+ **/
+gboolean spice_channel_get_msg_stats(SpiceChannel *channel, guint type, SpiceMsgStats *stats)
+{
+    spice_channel *c;
+
+    g_return_val_if_fail(SPICE_IS_CHANNEL(channel), FALSE);
+    g_return_val_if_fail(stats != NULL, FALSE);
+
+    c = channel->priv;
+    if (type >= c->msg_stats_size || c->msg_stats[type].count == 0) {
+        memset(stats, 0, sizeof(*stats));
+        return FALSE;
+    }
+    *stats = c->msg_stats[type];
+    return TRUE;
+}
+
+/**
+ * spice_channel_reset_msg_stats:
+ * @channel:
+ *
+ * Reset the counters of all the message types.
+ **/
+void spice_channel_reset_msg_stats(SpiceChannel *channel)
+{
+    spice_channel *c;
+
+    g_return_if_fail(SPICE_IS_CHANNEL(channel));
+
+    c = channel->priv;
+    if (c->msg_stats)
+        memset(c->msg_stats, 0, c->msg_stats_size * sizeof(SpiceMsgStats));
+}
+
+/**
+ * spice_channel_msg_stats_to_json:
+ * @channel:
+ *
+ * Returns: a newly allocated JSON object with the counters of each
+ * message type received, times in nanoseconds.
+ **/
+gchar *spice_channel_msg_stats_to_json(SpiceChannel *channel)
+{
+    spice_channel *c;
+    GString *json;
+    gboolean first = TRUE;
+    guint type;
+
+    g_return_val_if_fail(SPICE_IS_CHANNEL(channel), NULL);
+
+    c = channel->priv;
+    json = g_string_new(NULL);
+    g_string_append_printf(json, "{\"name\":\"%s\",\"type\":%d,\"id\":%d,\"messages\":[",
+                           c->name, c->channel_type, c->channel_id);
+    for (type = 0; type < c->msg_stats_size; type++) {
+        SpiceMsgStats *stats = &c->msg_stats[type];
+
+        if (stats->count == 0)
+            continue;
+        g_string_append_printf(json, "%s{\"type\":%u,\"count\":%" G_GUINT64_FORMAT
+                               ",\"bytes\":%" G_GUINT64_FORMAT
+                               ",\"parse_ns\":%" G_GUINT64_FORMAT
+                               ",\"handle_ns\":%" G_GUINT64_FORMAT "}",
+                               first ? "" : ",", type, stats->count, stats->bytes,
+                               stats->parse_ns, stats->handle_ns);
+        first = FALSE;
+    }
+    g_string_append(json, "]}");
+    return g_string_free(json, FALSE);
+}
+
 G_GNUC_INTERNAL
 SpiceSession* spice_channel_get_session(SpiceChannel *channel)
 {
@@ -1672,15 +1974,24 @@ void spice_channel_swap(SpiceChannel *channel, SpiceChannel *swap)
         SSL_CTX *ctx = c->ctx;
         SSL *ssl = c->ssl;
         SpiceOpenSSLVerify *sslverify = c->sslverify;
+        guint8 *recv_buffer = c->recv_buffer;
+        int recv_buffer_pos = c->recv_buffer_pos;
+        int recv_buffer_len = c->recv_buffer_len;
 
         c->sock = s->sock;
         c->ctx = s->ctx;
         c->ssl = s->ssl;
         c->sslverify = s->sslverify;
+        c->recv_buffer = s->recv_buffer;
+        c->recv_buffer_pos = s->recv_buffer_pos;
+        c->recv_buffer_len = s->recv_buffer_len;
 
         s->sock = sock;
         s->ctx = ctx;
         s->ssl = ssl;
         s->sslverify = sslverify;
+        s->recv_buffer = recv_buffer;
+        s->recv_buffer_pos = recv_buffer_pos;
+        s->recv_buffer_len = recv_buffer_len;
     }
 }
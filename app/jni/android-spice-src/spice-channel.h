@@ -87,17 +87,37 @@ struct _SpiceChannelClass
     /*< private >*/
     /* virtual method, any context */
     void (*channel_disconnect)(SpiceChannel *channel);
+
+    /* virtual method, coroutine context, before waiting for more data */
+    void (*read_idle)(SpiceChannel *channel);
     /*
      * If adding fields to this struct, remove corresponding
      * amount of padding to avoid changing overall struct size
      */
-    gchar _spice_reserved[SPICE_RESERVED_PADDING - 4 * sizeof(void*)];
+    gchar _spice_reserved[SPICE_RESERVED_PADDING - 5 * sizeof(void*)];
 };
 
 GType spice_channel_get_type(void) G_GNUC_CONST;
 
 typedef void (*spice_msg_handler)(SpiceChannel *channel, spice_msg_in *in);
 
+/**
+ * SpiceMsgStats:
+ * @count: number of messages received
+ * @bytes: size of their bodies
+ * @parse_ns: time spent demarshalling them
+ * @handle_ns: time spent in their handler
+ *
+ * Counters of a type of message received by a #SpiceChannel.
+ **/
+typedef struct _SpiceMsgStats SpiceMsgStats;
+struct _SpiceMsgStats {
+    guint64 count;
+    guint64 bytes;
+    guint64 parse_ns;
+    guint64 handle_ns;
+};
+
 SpiceChannel *spice_channel_new(SpiceSession *s, int type, int id);
 void spice_channel_destroy(SpiceChannel *channel);
 gboolean spice_channel_connect(SpiceChannel *channel);
@@ -105,6 +125,9 @@ gboolean spice_channel_open_fd(SpiceChannel *channel, int fd);
 void spice_channel_disconnect(SpiceChannel *channel, SpiceChannelEvent event);
 gboolean spice_channel_test_capability(SpiceChannel *channel, guint32 cap);
 void spice_channel_set_capability(SpiceChannel *channel, guint32 cap);
+gboolean spice_channel_get_msg_stats(SpiceChannel *channel, guint type, SpiceMsgStats *stats);
+void spice_channel_reset_msg_stats(SpiceChannel *channel);
+gchar *spice_channel_msg_stats_to_json(SpiceChannel *channel);
 
 G_END_DECLS
 
@@ -31,6 +31,8 @@ static char *password;
 static char *uri;
 static char *ca_file;
 static char *host_subject;
+static char *shared_framebuffer;
+static gint cache_size;
 
 static GOptionEntry spice_entries[] = {
     {
@@ -79,6 +81,18 @@ static GOptionEntry spice_entries[] = {
         .arg_data         = &host_subject,
         .description      = N_("Subject of the host certificate (field=value pairs separated by commas)"),
         .arg_description  = N_("<host-subject>"),
+    },{
+        .long_name        = "shared-framebuffer",
+        .arg              = G_OPTION_ARG_FILENAME,
+        .arg_data         = &shared_framebuffer,
+        .description      = N_("Share the primary surface with the UI through this file"),
+        .arg_description  = N_("<file>"),
+    },{
+        .long_name        = "cache-size",
+        .arg              = G_OPTION_ARG_INT,
+        .arg_data         = &cache_size,
+        .description      = N_("Image cache size, sized from the device memory by default"),
+        .arg_description  = N_("<bytes>"),
     },{
         /* end of list */
     }
@@ -121,4 +135,8 @@ void spice_cmdline_session_setup(SpiceSession *session)
         g_object_set(session, "ca-file", ca_file, NULL);
     if (host_subject)
         g_object_set(session, "cert-subject", host_subject, NULL);
+    if (shared_framebuffer)
+        g_object_set(session, "shared-framebuffer", shared_framebuffer, NULL);
+    if (cache_size > 0)
+        g_object_set(session, "cache-size", cache_size, NULL);
 }
@@ -28,6 +28,8 @@ SpiceSession *spice_session_new_from_session(SpiceSession *session);
 void spice_session_set_connection_id(SpiceSession *session, int id);
 int spice_session_get_connection_id(SpiceSession *session);
 gboolean spice_session_get_client_provided_socket(SpiceSession *session);
+const gchar* spice_session_get_shared_framebuffer(SpiceSession *session);
+gint spice_session_get_cache_size(SpiceSession *session);
 
 GSocket* spice_session_channel_open_host(SpiceSession *session, gboolean use_tls);
 void spice_session_channel_new(SpiceSession *session, SpiceChannel *channel);
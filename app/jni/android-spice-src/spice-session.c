@@ -54,6 +54,8 @@ struct spice_session {
     GList             *migration_left;
     SpiceSessionMigration migration_state;
     gboolean          disconnecting;
+    char              *shared_framebuffer;
+    int               cache_size;
 };
 
 /**
@@ -112,6 +114,8 @@ enum {
     PROP_CERT_SUBJECT,
     PROP_VERIFY,
     PROP_MIGRATION_STATE,
+    PROP_SHARED_FRAMEBUFFER,
+    PROP_CACHE_SIZE,
 };
 
 /* signals */
@@ -172,6 +176,7 @@ spice_session_finalize(GObject *gobject)
     g_free(s->password);
     g_free(s->ca_file);
     g_free(s->cert_subject);
+    g_free(s->shared_framebuffer);
 
     if (s->pubkey)
         g_byte_array_unref(s->pubkey);
@@ -310,6 +315,12 @@ static void spice_session_get_property(GObject    *gobject,
     case PROP_MIGRATION_STATE:
         g_value_set_enum(value, s->migration_state);
         break;
+    case PROP_SHARED_FRAMEBUFFER:
+        g_value_set_string(value, s->shared_framebuffer);
+	break;
+    case PROP_CACHE_SIZE:
+        g_value_set_int(value, s->cache_size);
+        break;
     default:
 	G_OBJECT_WARN_INVALID_PROPERTY_ID(gobject, prop_id, pspec);
 	break;
@@ -375,6 +386,13 @@ static void spice_session_set_property(GObject      *gobject,
     case PROP_MIGRATION_STATE:
         s->migration_state = g_value_get_enum(value);
         break;
+    case PROP_SHARED_FRAMEBUFFER:
+        g_free(s->shared_framebuffer);
+        s->shared_framebuffer = g_value_dup_string(value);
+        break;
+    case PROP_CACHE_SIZE:
+        s->cache_size = g_value_get_int(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(gobject, prop_id, pspec);
         break;
@@ -503,6 +521,24 @@ static void spice_session_class_init(SpiceSessionClass *klass)
                            G_PARAM_READABLE |
                            G_PARAM_STATIC_STRINGS));
 
+    g_object_class_install_property
+        (gobject_class, PROP_SHARED_FRAMEBUFFER,
+         g_param_spec_string("shared-framebuffer",
+                             "Shared framebuffer",
+                             "File the primary surface is mapped from",
+                             NULL,
+                             G_PARAM_READWRITE |
+                             G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property
+        (gobject_class, PROP_CACHE_SIZE,
+         g_param_spec_int("cache-size",
+                          "Cache size",
+                          "Image cache size in bytes, 0 to size it from the device memory",
+                          0, G_MAXINT, 0,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS));
+
     /**
      * SpiceSession::channel-new:
      * @session: the session that emitted the signal
@@ -574,6 +610,8 @@ SpiceSession *spice_session_new_from_session(SpiceSession *session)
                  "cert-subject", &c->cert_subject,
                  "pubkey", &c->pubkey,
                  "verify", &c->verify,
+                 "shared-framebuffer", &c->shared_framebuffer,
+                 "cache-size", &c->cache_size,
                  NULL);
 
     c->client_provided_sockets = s->client_provided_sockets;
@@ -640,6 +678,24 @@ gboolean spice_session_get_client_provided_socket(SpiceSession *session)
     return s->client_provided_sockets;
 }
 
+G_GNUC_INTERNAL
+const gchar* spice_session_get_shared_framebuffer(SpiceSession *session)
+{
+    spice_session *s = SPICE_SESSION_GET_PRIVATE(session);
+
+    g_return_val_if_fail(s != NULL, NULL);
+    return s->shared_framebuffer;
+}
+
+G_GNUC_INTERNAL
+gint spice_session_get_cache_size(SpiceSession *session)
+{
+    spice_session *s = SPICE_SESSION_GET_PRIVATE(session);
+
+    g_return_val_if_fail(s != NULL, 0);
+    return s->cache_size;
+}
+
 G_GNUC_INTERNAL
 void spice_session_switching_disconnect(SpiceSession *session)
 {
@@ -843,6 +899,33 @@ GList *spice_session_get_channels(SpiceSession *session)
     return list;
 }
 
+/**
+ * spice_session_msg_stats_to_json:
+ * @session:
+ *
+ * Returns: a newly allocated JSON object with the message counters of
+ * all the channels, see spice_channel_msg_stats_to_json().
+ **/
+gchar *spice_session_msg_stats_to_json(SpiceSession *session)
+{
+    GList *channels, *l;
+    GString *json;
+
+    g_return_val_if_fail(SPICE_IS_SESSION(session), NULL);
+
+    json = g_string_new("{\"channels\":[");
+    channels = spice_session_get_channels(session);
+    for (l = channels; l != NULL; l = l->next) {
+        gchar *channel = spice_channel_msg_stats_to_json(l->data);
+
+        g_string_append_printf(json, "%s%s", l == channels ? "" : ",", channel);
+        g_free(channel);
+    }
+    g_list_free(channels);
+    g_string_append(json, "]}");
+    return g_string_free(json, FALSE);
+}
+
 /* ------------------------------------------------------------------ */
 /* private functions                                                  */
 
@@ -92,6 +92,7 @@ gboolean spice_session_connect(SpiceSession *session);
 gboolean spice_session_open_fd(SpiceSession *session, int fd);
 void spice_session_disconnect(SpiceSession *session);
 GList *spice_session_get_channels(SpiceSession *session);
+gchar *spice_session_msg_stats_to_json(SpiceSession *session);
 
 G_END_DECLS
 
@@ -0,0 +1,228 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+   Copyright (C) 2010 Red Hat, Inc.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <android/log.h>
+
+#include "spice-trace.h"
+
+/* records per thread, a power of 2 */
+#define TRACE_RING_SIZE 4096
+
+typedef struct trace_record {
+    guint64 time; /* ns, CLOCK_MONOTONIC */
+    guint32 event;
+    guint32 ring; /* filled by the dump */
+    guint64 args[4];
+} trace_record;
+
+/* written by its owner thread only, read by the dump: head is published
+ * after the record, and the records overwritten during the copy are
+ * dropped from it */
+typedef struct trace_ring {
+    trace_record records[TRACE_RING_SIZE];
+    volatile gint head;
+    gboolean in_use;
+    guint id;
+} trace_ring;
+
+static const char *const trace_formats[SPICE_TRACE_N_EVENTS] = {
+#define TRACE_FORMAT(name, cat, level, fmt) fmt,
+    SPICE_TRACE_EVENTS(TRACE_FORMAT)
+#undef TRACE_FORMAT
+};
+
+volatile guint spice_trace_categories = 0;
+
+/* rings are never freed, the ring of an exited thread is reused */
+static GStaticMutex trace_lock = G_STATIC_MUTEX_INIT;
+static GSList *trace_rings;
+static GStaticPrivate trace_ring_key = G_STATIC_PRIVATE_INIT;
+
+/**
+ * spice_trace_set_categories:
+ * @categories: mask of SPICE_TRACE_CAT_*
+ *
+ * Enable recording of the trace points of @categories, 0 disables tracing.
+ **/
+void spice_trace_set_categories(guint categories)
+{
+    spice_trace_categories = categories;
+}
+
+guint spice_trace_get_categories(void)
+{
+    return spice_trace_categories;
+}
+
+static void trace_ring_release(gpointer data)
+{
+    trace_ring *ring = data;
+
+    g_static_mutex_lock(&trace_lock);
+    ring->in_use = FALSE;
+    g_static_mutex_unlock(&trace_lock);
+}
+
+static trace_ring *trace_ring_get(void)
+{
+    trace_ring *ring = g_static_private_get(&trace_ring_key);
+    GSList *l;
+
+    if (G_LIKELY(ring != NULL))
+        return ring;
+
+    g_static_mutex_lock(&trace_lock);
+    for (l = trace_rings; l != NULL; l = l->next) {
+        if (!((trace_ring *)l->data)->in_use) {
+            ring = l->data;
+            break;
+        }
+    }
+    if (ring == NULL) {
+        ring = g_new0(trace_ring, 1);
+        ring->id = g_slist_length(trace_rings);
+        trace_rings = g_slist_append(trace_rings, ring);
+    }
+    ring->in_use = TRUE;
+    g_static_mutex_unlock(&trace_lock);
+
+    g_static_private_set(&trace_ring_key, ring, trace_ring_release);
+    return ring;
+}
+
+void spice_trace_record(guint event, guint64 a0, guint64 a1, guint64 a2, guint64 a3)
+{
+    trace_ring *ring = trace_ring_get();
+    gint head = ring->head;
+    trace_record *r = &ring->records[head & (TRACE_RING_SIZE - 1)];
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    r->time = (guint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    r->event = event;
+    r->args[0] = a0;
+    r->args[1] = a1;
+    r->args[2] = a2;
+    r->args[3] = a3;
+    g_atomic_int_set(&ring->head, head + 1);
+}
+
+/* printf() with the conversions of the trace formats, all arguments
+ * being 64 bits wide */
+static void trace_format(GString *str, const char *fmt, const guint64 *args)
+{
+    int n = 0;
+
+    while (*fmt) {
+        const char *start = fmt;
+        char spec[16];
+        size_t len;
+
+        if (*fmt != '%') {
+            g_string_append_c(str, *fmt++);
+            continue;
+        }
+        fmt++;
+        if (*fmt == '%') {
+            g_string_append_c(str, *fmt++);
+            continue;
+        }
+        fmt += strspn(fmt, "-+ #0123456789");
+        len = fmt - start;
+        if (*fmt == '\0' || n == 4 || len + sizeof(G_GINT64_MODIFIER) + 1 > sizeof(spec)) {
+            g_string_append(str, start);
+            return;
+        }
+        memcpy(spec, start, len);
+        if (*fmt == 's') {
+            spec[len] = 's';
+            spec[len + 1] = '\0';
+            g_string_append_printf(str, spec, (const char *)(gsize)args[n++]);
+        } else {
+            strcpy(spec + len, G_GINT64_MODIFIER);
+            len += strlen(G_GINT64_MODIFIER);
+            spec[len] = *fmt;
+            spec[len + 1] = '\0';
+            g_string_append_printf(str, spec, args[n++]);
+        }
+        fmt++;
+    }
+}
+
+static int trace_record_cmp(const void *a, const void *b)
+{
+    const trace_record *ra = a, *rb = b;
+
+    if (ra->time != rb->time)
+        return ra->time < rb->time ? -1 : 1;
+    return 0;
+}
+
+/**
+ * spice_trace_dump:
+ *
+ * Log the records of all the threads, oldest first. Called on the
+ * ANDROID_TRACE_DUMP input message, and when the session ends.
+ **/
+void spice_trace_dump(void)
+{
+    GArray *records = g_array_new(FALSE, FALSE, sizeof(trace_record));
+    GString *str = g_string_new(NULL);
+    GSList *l;
+    guint i;
+
+    g_static_mutex_lock(&trace_lock);
+    for (l = trace_rings; l != NULL; l = l->next) {
+        trace_ring *ring = l->data;
+        gint head = g_atomic_int_get(&ring->head);
+        gint first = MAX(head - TRACE_RING_SIZE, 0);
+        guint start = records->len;
+        gint pos, overwritten;
+
+        for (pos = first; pos != head; pos++) {
+            g_array_append_val(records, ring->records[pos & (TRACE_RING_SIZE - 1)]);
+            g_array_index(records, trace_record, records->len - 1).ring = ring->id;
+        }
+        /* the owner may have overwritten the oldest ones meanwhile */
+        overwritten = g_atomic_int_get(&ring->head) - TRACE_RING_SIZE + 1 - first;
+        if (overwritten > 0)
+            g_array_remove_range(records, start, MIN((guint)overwritten, records->len - start));
+    }
+    g_static_mutex_unlock(&trace_lock);
+
+    g_array_sort(records, trace_record_cmp);
+    for (i = 0; i < records->len; i++) {
+        const trace_record *r = &g_array_index(records, trace_record, i);
+
+        if (r->event >= SPICE_TRACE_N_EVENTS)
+            continue;
+        g_string_printf(str, "[%u] %" G_GUINT64_FORMAT ".%06u ", r->ring,
+                        r->time / 1000000000, (guint)(r->time % 1000000000 / 1000));
+        trace_format(str, trace_formats[r->event], r->args);
+        __android_log_print(ANDROID_LOG_INFO, "----spice-android----", "%s", str->str);
+    }
+
+    g_string_free(str, TRUE);
+    g_array_free(records, TRUE);
+}
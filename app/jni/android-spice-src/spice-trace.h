@@ -0,0 +1,107 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+   Copyright (C) 2010 Red Hat, Inc.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SPICE_TRACE_H
+#define SPICE_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Trace points record a fixed-size binary event (timestamp, event id and
+ * up to 4 integer arguments) into a ring owned by the calling thread, the
+ * format string is only applied by spice_trace_dump().
+ *
+ * Events of a category not in SPICE_TRACE_CATEGORIES, or of a level
+ * above SPICE_TRACE_LEVEL, are compiled out. The others cost a load and
+ * a test until enabled at runtime with spice_trace_set_categories().
+ */
+
+#define SPICE_TRACE_CAT_CHANNEL  (1 << 0)
+#define SPICE_TRACE_CAT_DISPLAY  (1 << 1)
+#define SPICE_TRACE_CAT_CANVAS   (1 << 2)
+#define SPICE_TRACE_CAT_CACHE    (1 << 3)
+#define SPICE_TRACE_CAT_ALL      0xffff
+
+#define SPICE_TRACE_LEVEL_INFO    1
+#define SPICE_TRACE_LEVEL_DEBUG   2
+#define SPICE_TRACE_LEVEL_VERBOSE 3
+
+#ifndef SPICE_TRACE_CATEGORIES
+#define SPICE_TRACE_CATEGORIES SPICE_TRACE_CAT_ALL
+#endif
+
+#ifndef SPICE_TRACE_LEVEL
+#define SPICE_TRACE_LEVEL SPICE_TRACE_LEVEL_DEBUG
+#endif
+
+/* name, category, level, format: the arguments are 64 bits wide, integers
+ * take %d %u %x without length modifier, static or interned strings
+ * passed with SPICE_TRACE_PTR() take %s */
+#define SPICE_TRACE_EVENTS(X)                                                   \
+    X(CHANNEL_RECV, CHANNEL, DEBUG, "%s: recv type %u size %u")                 \
+    X(CHANNEL_SEND, CHANNEL, DEBUG, "%s: send type %u size %u buffered %u")     \
+    X(CHANNEL_WAIT, CHANNEL, VERBOSE, "%s: wait for io condition %x")           \
+    X(DISPLAY_MSG, DISPLAY, DEBUG, "display: handle msg type %u")               \
+    X(DISPLAY_DECODE, DISPLAY, DEBUG, "display: predecode msg type %u queued %u") \
+    X(DISPLAY_DROP, DISPLAY, DEBUG, "display: clipped out msg type %u dropped") \
+    X(CANVAS_IMAGE, CANVAS, DEBUG, "canvas: image type %u flags %x %ux%u")      \
+    X(CACHE_MISS, CACHE, DEBUG, "%s cache: miss %016x")                       \
+    X(CACHE_ADD, CACHE, DEBUG, "%s cache: add %016x (%u items)")              \
+    X(CACHE_DEL, CACHE, DEBUG, "%s cache: del %016x")
+
+#define SPICE_TRACE_EVENT_ID(name, cat, level, fmt) SPICE_TRACE_##name,
+#define SPICE_TRACE_EVENT_CAT(name, cat, level, fmt)                    \
+    SPICE_TRACE_##name##_CAT = SPICE_TRACE_CAT_##cat,                   \
+    SPICE_TRACE_##name##_LEVEL = SPICE_TRACE_LEVEL_##level,
+
+enum {
+    SPICE_TRACE_EVENTS(SPICE_TRACE_EVENT_ID)
+    SPICE_TRACE_N_EVENTS
+};
+
+enum {
+    SPICE_TRACE_EVENTS(SPICE_TRACE_EVENT_CAT)
+};
+
+#undef SPICE_TRACE_EVENT_ID
+#undef SPICE_TRACE_EVENT_CAT
+
+#define SPICE_TRACE_PTR(ptr) ((guint64)(gsize)(ptr))
+
+G_GNUC_INTERNAL extern volatile guint spice_trace_categories;
+
+#define SPICE_TRACE(name, ...) SPICE_TRACE_ARGS(name, __VA_ARGS__, 0, 0, 0, 0)
+
+#define SPICE_TRACE_ARGS(name, a0, a1, a2, a3, ...)                     \
+    G_STMT_START {                                                      \
+        if ((SPICE_TRACE_##name##_CAT & SPICE_TRACE_CATEGORIES) &&      \
+            SPICE_TRACE_##name##_LEVEL <= SPICE_TRACE_LEVEL &&          \
+            G_UNLIKELY(spice_trace_categories & SPICE_TRACE_##name##_CAT)) \
+            spice_trace_record(SPICE_TRACE_##name, (guint64)(a0), (guint64)(a1), \
+                               (guint64)(a2), (guint64)(a3));           \
+    } G_STMT_END
+
+void spice_trace_set_categories(guint categories);
+guint spice_trace_get_categories(void);
+void spice_trace_record(guint event, guint64 a0, guint64 a1, guint64 a2, guint64 a3);
+void spice_trace_dump(void);
+
+G_END_DECLS
+
+#endif /* SPICE_TRACE_H */
@@ -32,23 +32,26 @@
  * Various functions for debugging and informational purposes.
  */
 
-static gboolean debugFlag = FALSE;
+static gint debugFlag = -1; /* unset, SPICE_DEBUG decides */
 
 /**
  * spice_util_set_debug:
  * @enabled: %TRUE or %FALSE
  *
- * Enable or disable Spice-GTK debugging messages.
+ * Enable or disable Spice-GTK debugging messages, and the recording of
+ * all the trace points.
  **/
 void spice_util_set_debug(gboolean enabled)
 {
     debugFlag = enabled;
+    spice_trace_set_categories(enabled ? SPICE_TRACE_CAT_ALL : 0);
 }
 
 gboolean spice_util_get_debug(void)
 {
-    //return TRUE;
-    return debugFlag || g_getenv("SPICE_DEBUG") != NULL;
+    if (G_UNLIKELY(debugFlag == -1))
+        spice_util_set_debug(g_getenv("SPICE_DEBUG") != NULL);
+    return debugFlag;
 }
 
 /**
@@ -20,6 +20,7 @@
 
 #include <glib.h>
 #include<android/log.h> 
+#include "spice-trace.h"
 
 G_BEGIN_DECLS
 
@@ -27,9 +28,10 @@ void spice_util_set_debug(gboolean enabled);
 gboolean spice_util_get_debug(void);
 const gchar *spice_util_get_version_string(void);
 
+/* formatted and logged right away, use SPICE_TRACE() on hot paths */
 #define SPICE_DEBUG(fmt, ...)                                   \
     do {                                                        \
-	if (1 || G_UNLIKELY(spice_util_get_debug()))                 \
+	if (G_UNLIKELY(spice_util_get_debug()))                      \
 	__android_log_print(ANDROID_LOG_ERROR,"----spice-android----",fmt, ##__VA_ARGS__);\
     } while (0)
 
@@ -22,7 +22,6 @@
 
 #include <sys/stat.h>
 #include "android-spice.h"
-#include "jpeg_encoder.h"
 #include "spice-common.h"
 #include "spice-audio.h"
 #include "spice-cmdline.h"
@@ -59,14 +58,22 @@ struct spice_connection {
 
 //for android-workers threads
 volatile GMainLoop* android_mainloop;
-volatile JpegEncoder* android_jpeg_encoder;
-volatile int android_task_ready;
-volatile int android_task;
-pthread_mutex_t android_mutex = PTHREAD_MUTEX_INITIALIZER;  
-pthread_cond_t android_cond = PTHREAD_COND_INITIALIZER;  
 
 static GMainLoop     *mainloop;
 static int           connections;
+static int           frame_interval = ANDROID_FRAME_INTERVAL;
+
+static GOptionEntry cmd_entries[] = {
+    {
+        .long_name        = "frame-interval",
+        .arg              = G_OPTION_ARG_INT,
+        .arg_data         = &frame_interval,
+        .description      = N_("Period of the display updates sent to the UI"),
+        .arg_description  = N_("<msecs>"),
+    },{
+        /* end of list */
+    }
+};
 
 static spice_connection *connection_new(void);
 static void connection_connect(spice_connection *conn);
@@ -89,6 +96,7 @@ static spice_window *create_spice_window(spice_connection *conn, int id)
     g_message("create window (#%d)", win->id);
 
     win->spice = (spice_display_new(conn->session, id));
+    spice_display_set_frame_interval(win->spice, frame_interval);
     return win;
 }
 
@@ -278,6 +286,7 @@ static void connection_destroy(spice_connection *conn)
 	    return;
     }
 
+    spice_trace_dump();
     g_main_loop_quit(mainloop);
 }
 
@@ -338,11 +347,11 @@ JNIEXPORT jint JNICALL Java_com_firework_virtualdesktop_socket_Connector_Android
     SPICE_DEBUG("libspicec started");
 #ifndef C_ANDROID
     jboolean  b  = true;
-    char cmd[128];
+    char cmd[512];
     memset(cmd, 0, sizeof(cmd));
     if (str != NULL)
     {
-        strcpy(cmd ,(const char*)(*env)->GetStringUTFChars(env,str, &b));
+        strncpy(cmd ,(const char*)(*env)->GetStringUTFChars(env,str, &b), sizeof(cmd) - 1);
     }
 #endif
 
@@ -373,6 +382,7 @@ JNIEXPORT jint JNICALL Java_com_firework_virtualdesktop_socket_Connector_Android
     /* parse opts */
     SPICE_DEBUG("parse started");
     context = g_option_context_new(_("- spice client application"));
+    g_option_context_add_main_entries(context, cmd_entries, NULL);
     g_option_context_add_group(context, spice_cmdline_get_option_group());
     SPICE_DEBUG("here");
     if (!g_option_context_parse (context, &argc, &argv, &error))
@@ -398,17 +408,15 @@ JNIEXPORT jint JNICALL Java_com_firework_virtualdesktop_socket_Connector_Android
 
     if (connections > 0) {
 	    SPICE_DEBUG("start I/O threads");
+	    android_output_init();
 	    //start the android workers threads
 	    iret1 = pthread_create( &android_input, NULL, (void*)android_spice_input, NULL);
 	    iret2 = pthread_create( &android_output, NULL, (void*)android_spice_output, NULL);
-	    //create jpeg_encoder for the jpg images to JAVA
-	    android_jpeg_encoder = jpeg_encoder_create();
 
 	    g_main_loop_run(mainloop);
 
 	    pthread_join(android_input, NULL);
 	    pthread_join(android_output, NULL);
-	    jpeg_encoder_destroy(android_jpeg_encoder);
 	    SPICE_DEBUG("stop I/O threads");
     }
 
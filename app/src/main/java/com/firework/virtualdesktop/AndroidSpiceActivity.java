@@ -7,6 +7,7 @@ import android.os.Bundle;
 import android.support.v7.app.AppCompatActivity;
 import android.view.View;
 import android.widget.Button;
+import android.widget.CheckBox;
 import android.widget.TextView;
 import android.widget.Toast;
 
@@ -24,6 +25,7 @@ public class AndroidSpiceActivity extends Activity {
     private TextView resultView;
     private Button settingBtn;
     private Button connectBtn;
+    private CheckBox sharedFramebufferBox;
 
     static {
         System.loadLibrary("spicec");
@@ -43,6 +45,7 @@ public class AndroidSpiceActivity extends Activity {
         resultView.setTextColor(Color.RED);
         settingBtn = (Button)findViewById(R.id.SettingBtn);
         connectBtn = (Button)findViewById(R.id.ConnectBtn);
+        sharedFramebufferBox = (CheckBox)findViewById(R.id.SharedFramebufferBox);
 
 
         settingBtn.setOnClickListener(new View.OnClickListener() {
@@ -67,6 +70,7 @@ public class AndroidSpiceActivity extends Activity {
     }
 
     private boolean StartSpice(String ip, String port, String password) {
+        Connector.getInstance().setSharedFramebuffer(sharedFramebufferBox.isChecked());
         int rs = Connector.getInstance().connect(ip, port, password);
         switch(rs) {
             case Connector.CONNECT_IP_PORT_ERROR:
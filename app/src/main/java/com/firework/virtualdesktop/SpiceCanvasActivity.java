@@ -77,7 +77,7 @@ public class SpiceCanvasActivity extends Activity {
         };
 
         inputSender = new InputSender();
-        frameReciver = new FrameReciver(canvas);
+        frameReciver = new FrameReciver(canvas, inputSender);
         Connector.getInstance().setHandler(handler);
 
         canvas.setOnTouchListener(new SpiceCanvasOnTouchListener());
@@ -170,6 +170,13 @@ public class SpiceCanvasActivity extends Activity {
                 }
                 canvas.zoom(scaling);
                 return true;
+            case R.id.stats:
+                // logged by FrameReciver when the answer comes
+                inputSender.requestStats();
+                return true;
+            case R.id.trace_dump:
+                inputSender.requestTraceDump();
+                return true;
             case R.id.exit:
                 inputSender.sendOverMsg();
                 inputSender.stop();
@@ -12,4 +12,13 @@ public class DGType {
     public static final int ANDROID_BUTTON_PRESS = 3;
     public static final int ANDROID_BUTTON_RELEASE = 4;
     public static final int ANDROID_SHOW = 5;
+    public static final int ANDROID_SHM_CREATE = 6;
+    public static final int ANDROID_SHM_SHOW = 7;
+    public static final int ANDROID_SHOW_FILL = 8;
+    public static final int ANDROID_SHOW_PALETTE = 9;
+    public static final int ANDROID_SHOW_ZLIB = 10;
+    public static final int ANDROID_TILE_COPY = 11;
+    public static final int ANDROID_TILE_STORE = 12;
+    public static final int ANDROID_STATS = 13;
+    public static final int ANDROID_TRACE_DUMP = 14;
 }
@@ -25,6 +25,7 @@ public class Connector {
 
     private Handler handler = null;
     private int rs = CONNECT_SUCCESS;
+    private boolean sharedFramebuffer = false;
 
     public void setHandler(Handler handler) {
         this.handler = handler;
@@ -34,6 +35,14 @@ public class Connector {
         return handler;
     }
 
+    /**
+     * map the remote desktop from libspicec instead of receiving JPEGs
+     * @param sharedFramebuffer
+     */
+    public void setSharedFramebuffer(boolean sharedFramebuffer) {
+        this.sharedFramebuffer = sharedFramebuffer;
+    }
+
     class StartRun extends Thread {
         private String cmd;
 
@@ -67,6 +76,9 @@ public class Connector {
         buf.append("spicy -h ").append(ip);
         buf.append(" -p ").append(port);
         buf.append(" -w ").append(password);
+        if (sharedFramebuffer) {
+            buf.append(" --shared-framebuffer ").append(FrameReciver.SHARED_FRAMEBUFFER);
+        }
 
         new StartRun(buf.toString()).start();
         //if success, ConnectT process will block all the time
@@ -2,23 +2,38 @@ package com.firework.virtualdesktop.socket;
 
 import java.io.DataInputStream;
 import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+import java.nio.channels.FileChannel;
+import java.util.Arrays;
+import java.util.zip.DataFormatException;
+import java.util.zip.Inflater;
 
 import android.graphics.Bitmap;
 import android.graphics.Bitmap.Config;
 import android.graphics.BitmapFactory;
 import android.graphics.BitmapFactory.Options;
 import android.graphics.Canvas;
+import android.graphics.Rect;
+import android.graphics.Region;
 import android.os.Message;
+import android.util.Log;
 
 import com.firework.virtualdesktop.SpiceCanvas;
 import com.firework.virtualdesktop.datagram.BitmapDG;
+import com.firework.virtualdesktop.datagram.DGType;
 
 /**
  * Created by lujie on 11/13/17.
  */
 
 public class FrameReciver {
+    public static final String SHARED_FRAMEBUFFER = "/home/lujie/AndroidStudioProjects/VirtualDesktop/socket_data/spice-framebuffer";
+
     private SpiceCanvas canvas;
+    private InputSender inputSender;
     private SocketHandler socketHandler = new SocketHandler("/home/lujie/AndroidStudioProjects/VirtualDesktop/socket_data/spice-output.socket");
     private boolean keepRecieve = true;
     private FrameRecieveT frameReciveT = null;
@@ -27,9 +42,11 @@ public class FrameReciver {
     /**
      * init
      * @param canvas
+     * @param inputSender acknowledges the cached tiles
      */
-    public FrameReciver(SpiceCanvas canvas) {
+    public FrameReciver(SpiceCanvas canvas, InputSender inputSender) {
         this.canvas = canvas;
+        this.inputSender = inputSender;
         opt = new Options();
         opt.inPreferredConfig = Config.ARGB_8888;
     }
@@ -71,17 +88,51 @@ public class FrameReciver {
             try {
                 DataInputStream inputStream = socketHandler.getInput();
                 BitmapDG bmpDg = canvas.getBitmapDG();
-                bmpDg.setDgType(inputStream.readInt());
-                bmpDg.setWidth(inputStream.readInt());
-                bmpDg.setHeight(inputStream.readInt());
+                int type = inputStream.readInt();
+                int w = inputStream.readInt();
+                int h = inputStream.readInt();
+                bmpDg.setDgType(type);
                 bmpDg.setX(inputStream.readInt());
                 bmpDg.setY(inputStream.readInt());
                 int size = inputStream.readInt();
 
-                byte[] bs = new byte[size];
-                inputStream.readFully(bs);
-                Bitmap bmpp = BitmapFactory.decodeByteArray(bs, 0, size, opt);
-                bmpDg.setBitmap(combine(bmpp, bmpDg.getY()));
+                Bitmap frame;
+                if (type == DGType.ANDROID_SHM_CREATE || type == DGType.ANDROID_SHM_SHOW) {
+                    if (size != shmSeq + 1) {
+                        Log.v("firework", "framebuffer notifications lost: " + shmSeq + " -> " + size);
+                    }
+                    shmSeq = size;
+                }
+                if (type == DGType.ANDROID_SHM_CREATE) {
+                    mapFramebuffer(w, h, bmpDg.getX());
+                    return;
+                } else if (type == DGType.ANDROID_SHM_SHOW) {
+                    frame = copyFromFramebuffer(bmpDg.getX(), bmpDg.getY(), w, h);
+                } else {
+                    byte[] bs = new byte[size];
+                    inputStream.readFully(bs);
+                    if (type == DGType.ANDROID_STATS) {
+                        Log.i("firework", "message stats: " + new String(bs, "UTF-8"));
+                        return;
+                    } else if (type == DGType.ANDROID_TILE_STORE) {
+                        storeTiles(bs, w, h, bmpDg.getX());
+                        return;
+                    } else if (type == DGType.ANDROID_TILE_COPY) {
+                        frame = copyTiles(bs);
+                    } else if (type == DGType.ANDROID_SHOW) {
+                        Bitmap bmpp = BitmapFactory.decodeByteArray(bs, 0, size, opt);
+                        lossy.op(bmpDg.getX(), bmpDg.getY(), bmpDg.getX() + bmpp.getWidth(),
+                                bmpDg.getY() + bmpp.getHeight(), Region.Op.UNION);
+                        frame = combine(bmpp, bmpDg.getX(), bmpDg.getY());
+                    } else {
+                        lossy.op(bmpDg.getX(), bmpDg.getY(), bmpDg.getX() + w, bmpDg.getY() + h,
+                                Region.Op.DIFFERENCE);
+                        frame = combine(decodePixels(type, bs, w, h), bmpDg.getX(), bmpDg.getY(), w, h);
+                    }
+                }
+                bmpDg.setWidth(frame.getWidth());
+                bmpDg.setHeight(frame.getHeight());
+                bmpDg.setBitmap(frame);
 
                 Message message = new Message();
                 message.what = SpiceCanvas.UPDATE_CANVAS;
@@ -102,15 +153,211 @@ public class FrameReciver {
 
     private Canvas cvs = null;
     private Bitmap bmpOverlay = null;
-    private Bitmap combine(Bitmap bmp, int y) {
+
+    /**
+     * make sure the persistent desktop bitmap covers (0,0)-(w,h),
+     * growing it while keeping its content
+     * @param w
+     * @param h
+     */
+    private void ensureOverlay(int w, int h) {
+        if (bmpOverlay == null || w > bmpOverlay.getWidth() || h > bmpOverlay.getHeight()) {
+            if (bmpOverlay != null) {
+                w = Math.max(w, bmpOverlay.getWidth());
+                h = Math.max(h, bmpOverlay.getHeight());
+            }
+            Bitmap grown = Bitmap.createBitmap(w, h, Config.ARGB_8888);
+            cvs = new Canvas(grown);
+            if (bmpOverlay != null) {
+                cvs.drawBitmap(bmpOverlay, 0, 0, null);
+            }
+            bmpOverlay = grown;
+        }
+    }
+
+    /**
+     * composite the damaged rectangle into the persistent desktop bitmap
+     * @param bmp
+     * @param x
+     * @param y
+     */
+    private Bitmap combine(Bitmap bmp, int x, int y) {
+        ensureOverlay(x + bmp.getWidth(), y + bmp.getHeight());
+        cvs.drawBitmap(bmp, x, y, null);
+        bmp.recycle();
+        return bmpOverlay;
+    }
+
+    /**
+     * composite decoded ARGB pixels into the persistent desktop bitmap
+     * @param px
+     * @param x
+     * @param y
+     * @param w
+     * @param h
+     */
+    private Bitmap combine(int[] px, int x, int y, int w, int h) {
+        ensureOverlay(x + w, y + h);
+        bmpOverlay.setPixels(px, 0, w, x, y, w, h);
+        return bmpOverlay;
+    }
+
+    /**
+     * decode the lossless encodings of libspicec (see android-codec.c)
+     * @param type
+     * @param bs
+     * @param w
+     * @param h
+     */
+    private int[] decodePixels(int type, byte[] bs, int w, int h) throws IOException {
+        int n = w * h;
+        if (pixels == null || pixels.length < n) {
+            pixels = new int[n];
+        }
+        ByteBuffer in = ByteBuffer.wrap(bs);
+        switch (type) {
+            case DGType.ANDROID_SHOW_FILL:
+                Arrays.fill(pixels, 0, n, in.getInt() | 0xff000000);
+                break;
+            case DGType.ANDROID_SHOW_PALETTE:
+                int[] palette = new int[in.getInt()];
+                for (int i = 0; i < palette.length; i++) {
+                    palette[i] = in.getInt() | 0xff000000;
+                }
+                for (int i = 0; i < n; ) {
+                    int color = palette[in.get() & 0xff];
+                    int run = (in.get() & 0xff) + 1;
+                    Arrays.fill(pixels, i, i + run, color);
+                    i += run;
+                }
+                break;
+            case DGType.ANDROID_SHOW_ZLIB:
+                byte[] raw = new byte[n * 4];
+                Inflater inflater = new Inflater();
+                try {
+                    inflater.setInput(bs);
+                    if (inflater.inflate(raw) != raw.length) {
+                        throw new IOException("short zlib update");
+                    }
+                } catch (DataFormatException e) {
+                    throw new IOException(e.getMessage());
+                } finally {
+                    inflater.end();
+                }
+                ByteBuffer.wrap(raw).order(ByteOrder.LITTLE_ENDIAN).asIntBuffer().get(pixels, 0, n);
+                for (int i = 0; i < n; i++) {
+                    pixels[i] |= 0xff000000;
+                }
+                break;
+            default:
+                throw new IOException("unknown update type " + type);
+        }
+        return pixels;
+    }
+
+    private Bitmap[] tiles = new Bitmap[256];
+    private Rect tileSrc = new Rect();
+    private Rect tileDst = new Rect();
+    // the pixels of the desktop bitmap last drawn from a JPEG
+    private Region lossy = new Region();
+
+    /**
+     * cache the tiles of the desktop bitmap listed as (slot, x, y); only
+     * the lossless ones are acknowledged, libspicec never reuses the others
+     * @param bs
+     * @param w
+     * @param h
+     * @param gen
+     */
+    private void storeTiles(byte[] bs, int w, int h, int gen) {
         if (bmpOverlay == null) {
-            bmpOverlay = Bitmap.createBitmap(bmp.getWidth(), bmp.getHeight(), bmp.getConfig());
-            cvs = new Canvas(bmpOverlay);
-            cvs.drawBitmap(bmp, 0, 0, null);
-            return bmp;
+            return;
+        }
+        ByteBuffer in = ByteBuffer.wrap(bs);
+        tileDst.set(0, 0, w, h);
+        while (in.remaining() >= 12) {
+            int slot = in.getInt();
+            int x = in.getInt();
+            int y = in.getInt();
+            if (!lossy.quickReject(x, y, x + w, y + h)) {
+                continue;
+            }
+            if (tiles[slot] == null) {
+                tiles[slot] = Bitmap.createBitmap(w, h, Config.ARGB_8888);
+            }
+            tileSrc.set(x, y, x + w, y + h);
+            new Canvas(tiles[slot]).drawBitmap(bmpOverlay, tileSrc, tileDst, null);
+            inputSender.acknowledgeTile(slot, gen);
+        }
+    }
+
+    /**
+     * draw cached tiles, listed as (slot, x, y), into the desktop bitmap
+     * @param bs
+     */
+    private Bitmap copyTiles(byte[] bs) throws IOException {
+        ByteBuffer in = ByteBuffer.wrap(bs);
+        while (in.remaining() >= 12) {
+            int slot = in.getInt();
+            int x = in.getInt();
+            int y = in.getInt();
+            if (tiles[slot] == null || bmpOverlay == null) {
+                throw new IOException("tile slot " + slot + " was never stored");
+            }
+            cvs.drawBitmap(tiles[slot], x, y, null);
+            lossy.op(x, y, x + tiles[slot].getWidth(), y + tiles[slot].getHeight(), Region.Op.DIFFERENCE);
+        }
+        return bmpOverlay;
+    }
+
+    private IntBuffer framebuffer = null;
+    private int fbStride = 0;
+    private int[] pixels = null;
+    private int shmSeq = 0;
+
+    /**
+     * map the primary surface shared by libspicec
+     * @param w
+     * @param h
+     * @param stride bytes per row of the surface
+     */
+    private void mapFramebuffer(int w, int h, int stride) throws IOException {
+        RandomAccessFile file = new RandomAccessFile(SHARED_FRAMEBUFFER, "r");
+        try {
+            framebuffer = file.getChannel()
+                    .map(FileChannel.MapMode.READ_ONLY, 0, (long) stride * h)
+                    .order(ByteOrder.LITTLE_ENDIAN).asIntBuffer();
+        } finally {
+            file.close();
+        }
+        fbStride = stride / 4;
+        bmpOverlay = Bitmap.createBitmap(w, h, Config.ARGB_8888);
+        cvs = new Canvas(bmpOverlay);
+    }
+
+    /**
+     * copy the damaged rectangle from the shared framebuffer: its xRGB
+     * pixels only need an opaque alpha to become ARGB_8888 colors
+     * @param x
+     * @param y
+     * @param w
+     * @param h
+     */
+    private Bitmap copyFromFramebuffer(int x, int y, int w, int h) throws IOException {
+        if (framebuffer == null) {
+            throw new IOException("no shared framebuffer mapped");
+        }
+        if (pixels == null || pixels.length < w * h) {
+            pixels = new int[w * h];
+        }
+        for (int j = 0; j < h; j++) {
+            framebuffer.position((y + j) * fbStride + x);
+            framebuffer.get(pixels, j * w, w);
+        }
+        for (int i = 0; i < w * h; i++) {
+            pixels[i] |= 0xff000000;
         }
-        cvs.drawBitmap(bmpOverlay, 0, 0, null);
-        cvs.drawBitmap(bmp, 0, y, null);
+        bmpOverlay.setPixels(pixels, 0, w, x, y, w, h);
         return bmpOverlay;
     }
 }
@@ -18,7 +18,7 @@ public class InputSender {
      *
      * @param keyDg
      */
-    public void sendKey(KeyDG keyDg) {
+    public synchronized void sendKey(KeyDG keyDg) {
         if (!socketHandler.isConnected()) {
             if (!socketHandler.connect()) {
                 return;
@@ -43,7 +43,7 @@ public class InputSender {
      *
      * @param mouseDg
      */
-    public void sendMouse(MouseDG mouseDg) {
+    public synchronized void sendMouse(MouseDG mouseDg) {
         if (!socketHandler.isConnected()) {
             if (!socketHandler.connect()) {
                 return;
@@ -64,7 +64,7 @@ public class InputSender {
     /**
      *
      */
-    public void sendOverMsg() {
+    public synchronized void sendOverMsg() {
         if (!socketHandler.isConnected()) {
             if (!socketHandler.connect()) {
                 return;
@@ -79,10 +79,70 @@ public class InputSender {
         }
     }
 
+    /**
+     * ask for the per message type counters of the spice channels, they
+     * come back as an ANDROID_STATS frame
+     */
+    public synchronized void requestStats() {
+        if (!socketHandler.isConnected()) {
+            if (!socketHandler.connect()) {
+                return;
+            }
+        }
+        try {
+            DataOutputStream outputStream = socketHandler.getOutput();
+            outputStream.writeInt(DGType.ANDROID_STATS);
+        } catch (IOException e) {
+            e.printStackTrace();
+            socketHandler.close();
+        }
+    }
+
+    /**
+     * tell libspicec that the tile stored in slot by the ANDROID_TILE_STORE
+     * of generation gen holds lossless pixels, so it may be copied from
+     * @param slot
+     * @param gen
+     */
+    public synchronized void acknowledgeTile(int slot, int gen) {
+        if (!socketHandler.isConnected()) {
+            if (!socketHandler.connect()) {
+                return;
+            }
+        }
+        try {
+            DataOutputStream outputStream = socketHandler.getOutput();
+            outputStream.writeInt(DGType.ANDROID_TILE_STORE);
+            outputStream.writeInt(slot);
+            outputStream.writeInt(gen);
+        } catch (IOException e) {
+            e.printStackTrace();
+            socketHandler.close();
+        }
+    }
+
+    /**
+     * have libspicec write its trace records to the log
+     */
+    public synchronized void requestTraceDump() {
+        if (!socketHandler.isConnected()) {
+            if (!socketHandler.connect()) {
+                return;
+            }
+        }
+        try {
+            DataOutputStream outputStream = socketHandler.getOutput();
+            outputStream.writeInt(DGType.ANDROID_TRACE_DUMP);
+        } catch (IOException e) {
+            e.printStackTrace();
+            socketHandler.close();
+        }
+    }
+
     /**
      *
      */
-    public void stop() {
+    public synchronized void stop() {
         socketHandler.close();
     }
 }